@@ -8,10 +8,13 @@
 // Includes
 #include <algorithm>
 #include <ctime>
+#include <sys/time.h>
 #include <memory>
 #include <sstream>
+#include <vector>
 #include <PubSubClient.h>
 #include <ArduinoJson.h>
+#include <SPIFFS.h>
 
 #include "Network.h"
 #include "local_time.h"
@@ -22,6 +25,41 @@
 #include "date.h"
 #include "datetime.h"
 #include "mytime.h"
+#include "event_index.h"
+#include "text_layout.h"
+#include "layout_cache.h"
+#include "frame_diff.h"
+#include "raster.h"
+#include "display_list.h"
+#include "band_render.h"
+#include "calendar_page.h"
+#include "glyph_atlas.h"
+#include "frame_layer.h"
+#include "snapshot.h"
+#include "font_store.h"
+#include "refresh_policy.h"
+#include "frame_delta.h"
+#include "deadline_queue.h"
+
+// Older config.h files predate the time grid
+#ifndef TIME_GRID
+#define TIME_GRID 0
+#define TIME_GRID_FIRST_HOUR 7
+#define TIME_GRID_LAST_HOUR 21
+#endif
+
+// Or thin client mode
+#ifndef THIN_CLIENT
+#define THIN_CLIENT 0
+#endif
+
+// Only the Inkplate 6PLUS has a touchscreen to page with, and thin
+// clients have nothing to page through
+#if defined(ARDUINO_INKPLATE6PLUS) && !THIN_CLIENT
+#define TOUCH_PAGING 1
+#else
+#define TOUCH_PAGING 0
+#endif
 
 namespace Project
 {
@@ -37,42 +75,204 @@ namespace Project
   // Variables to keep count of when to get new data, and when to just update time
   RTC_DATA_ATTR bool refreshed = false;
 
+  // Upper bound on events we index by id per message
+  const size_t MAX_EVENTS = 1024;
+
+  // Number of wrapped titles remembered between refreshes
+  const size_t LAYOUT_CACHE_SIZE = 256;
+
+  // Allocated on first use, after PSRAM is up
+  LayoutCache &layout_cache()
+  {
+    static LayoutCache cache(LAYOUT_CACHE_SIZE);
+    return cache;
+  }
+
+  // Fonts come from the font partition when it has them, otherwise
+  // the ones compiled in are used
+  const FontMetrics &findFont(const char *name, const GFXfont *compiled)
+  {
+    static FontStore *store = FontStore::open();
+    const FontMetrics *metrics = store != nullptr ? store->find(name) : nullptr;
+    return metrics != nullptr ? *metrics : FontMetrics::get(compiled);
+  }
+
+  const FontMetrics &titleFont()
+  {
+    static const FontMetrics &font = findFont("FreeSans12pt7b", &FreeSans12pt7b);
+    return font;
+  }
+
+  const FontMetrics &smallFont()
+  {
+    static const FontMetrics &font = findFont("FreeSans9pt7b", &FreeSans9pt7b);
+    return font;
+  }
+
+  // The page as config.h lays it out
+  page_style pageStyle()
+  {
+    page_style style;
+    style.width = SCREEN_WIDTH;
+    style.height = SCREEN_HEIGHT;
+    style.columns = COLUMNS;
+    style.column_width = COLUMN_WIDTH;
+    style.border_width = OUTSIDE_BORDER_WIDTH;
+    style.border_top = OUTSIDE_BORDER_TOP;
+    style.border_bottom = OUTSIDE_BORDER_BOTTOM;
+    style.inside_spacing_width = INSIDE_SPACING_WIDTH;
+    style.inside_spacing_height = INSIDE_SPACING_HEIGHT;
+    style.event_spacing_width = EVENT_SPACING_WIDTH;
+    style.event_spacing_height = EVENT_SPACING_HEIGHT;
+    style.header_height = HEADER_HEIGHT;
+    style.time_grid = TIME_GRID;
+    style.first_hour = TIME_GRID_FIRST_HOUR;
+    style.last_hour = TIME_GRID_LAST_HOUR;
+    style.title_font = &titleFont();
+    style.small_font = &smallFont();
+    return style;
+  }
+
+  // The events and how they're drawn, allocated on first use, after
+  // PSRAM is up and the font partition is open
+  CalendarPage &calendar()
+  {
+    static CalendarPage calendar_page(pageStyle(), layout_cache(), local_tz);
+    return calendar_page;
+  }
+
   // Initiate out Inkplate object
   Inkplate display(INKPLATE_3BIT);
 
   // Our networking functions, see Network.cpp for info
   Network network;
 
-  enum status_t
+  // Tracks which parts of the framebuffer changed since the last push
+  TileDiff frame_diff(E_INK_WIDTH, E_INK_HEIGHT, 4);
+
+  // Decides between partial, full and grayscale refreshes. Ghosting
+  // forces a full refresh after 20 partial updates or two screens'
+  // worth of them, and a grayscale refresh, which also cleans it up,
+  // is done at least hourly.
+  RefreshPolicy refresh_policy({20, 2.0f, 60 * 60 * 1000});
+
+  // Clock ticks go out as partial updates, a slower refresh is left to
+  // the clean refresh deadline
+  const unsigned long CLOCK_REFRESH_BUDGET_MS = 800;
+
+  // The calendar as drawing operations, rendered into the framebuffer
+  // by both cores at once
+  DisplayList frame_list;
+
+  // Title, grid and date labels, which only change at midnight.
+  // The layer holds them rendered for the current display mode, and is
+  // allocated on first use, after PSRAM is up.
+  DisplayList chrome_list;
+
+  FrameLayer &chrome_layer()
+  {
+    static FrameLayer layer(E_INK_WIDTH * E_INK_HEIGHT / 2);
+    return layer;
+  }
+
+  // Set once the calendar is on screen, until then the clock has
+  // nowhere to go
+  bool calendar_drawn = false;
+
+  // The last frame pushed to the panel, put back at boot so there is
+  // something useful on screen before the network is up. Saved after
+  // full refreshes and when the page changed, but not for partial
+  // updates of the clock alone: that would rewrite the file every
+  // minute, and at boot the clock is only a few minutes out until the
+  // first tick.
+  const char SNAPSHOT_PATH[] = "/frame.rle";
+  bool snapshot_storage = false;
+
+  // Set when more than the clock changed since the snapshot was saved
+  bool snapshot_stale = false;
+
+  // Whether the panel still shows the saved frame, kept over deep
+  // sleep. Cleared when the panel changes without a save.
+  RTC_DATA_ATTR bool panel_shows_snapshot = false;
+
+  // Which window of COLUMNS days is shown, page 0 starts today
+  int page = 0;
+
+  // The page on screen
+  page_layout shown_layout;
+
+  // What the screen is waiting on the time for: the clock to tick over,
+  // an event on the page to start or end, midnight moving the days, and
+  // a clean refresh falling due
+  enum deadline_t
   {
-    pending,
-    in_progress,
-    completed,
-    cancelled
+    CLOCK_TICK,
+    STATUS_CHANGE,
+    MIDNIGHT,
+    CLEAN_REFRESH,
+    DEADLINES
   };
-  // Struct for storing calender event info
-  struct entry
-  {
-    String title;
-    DateTime start_time;
-    DateTime end_time;
-    Date start_date;
-    Date end_date;
-    int day;
-    status_t status;
-
-    entry(String &summary, DateTime &start_time, DateTime &end_time, Date &start_date, Date &end_date, int day, status_t status);
+  DeadlineQueue deadlines(DEADLINES);
+
+  // Longest the loop sleeps between deadlines. Touches and MQTT
+  // messages don't wait for one.
+#if TOUCH_PAGING
+  const unsigned long IDLE_SLEEP_MS = 20;
+#else
+  const unsigned long IDLE_SLEEP_MS = 1000;
+#endif
+
+#if TOUCH_PAGING
+  // Back to today this long after the last page flip
+  const unsigned long PAGE_TIMEOUT_MS = 5 * 60 * 1000;
+  unsigned long last_page_flip = 0;
+
+  // Touches that move further than this sideways are swipes, and
+  // a touch counts as lifted after this long without a report
+  const int SWIPE_MIN_DISTANCE = 100;
+  const unsigned long TOUCH_RELEASE_MS = 200;
+
+  // The pages either side of the one shown, rendered while there's
+  // nothing else to do. Flipping to one of them only costs the panel
+  // refresh. Allocated on first use, after PSRAM is up.
+  const int SPARE_PAGES = 2;
+  struct spare_page
+  {
+    FrameLayer *layer;
+    bool grayscale;
+    page_layout layout;
   };
 
-  // Constructor for entry
-  entry::entry(String &summary, DateTime &start_time, DateTime &end_time, Date &start_date, Date &end_date, int day, status_t status) : title(summary), start_time(start_time), end_time(end_time), start_date(start_date), end_date(end_date), day(day), status(status) {}
+  spare_page *spare_pages()
+  {
+    static spare_page pages[SPARE_PAGES] = {
+        {new FrameLayer(E_INK_WIDTH * E_INK_HEIGHT / 2), false, page_layout()},
+        {new FrameLayer(E_INK_WIDTH * E_INK_HEIGHT / 2), false, page_layout()}};
+    return pages;
+  }
+#endif
 
   // All our functions declared below setup and loop
-  void drawInfo();
-  void drawTime();
-  void drawGrid();
-  bool drawEvent(const entry &event, int day, int beginY, int max_y, int *y_next);
-  void drawData(const JsonArray &array);
+  void buildChrome(const Date &local_date);
+  void selectMode(bool grayscale);
+  void drawChrome(const Date &local_date);
+  void parseEvents(const JsonArray &array);
+  void drawData(DisplayList &list, const Date &begin_date, page_layout &layout);
+  bool refreshStatuses(page_layout &layout, seconds_t now);
+  void renderFrame(const DisplayList &list);
+  void renderClock();
+  void showPage();
+  void pushFrame(unsigned long budget_ms);
+  void scheduleCleanRefresh(unsigned long in_ms);
+  void saveSnapshot();
+  bool restoreSnapshot();
+  void drawClock();
+  bool runDeadlines();
+  void idle();
+  void applyDelta(const uint8_t *message, size_t length);
+#ifdef RASTER_BENCHMARK
+  void benchmarkRaster();
+#endif
   void callback(char *topic, byte *message, unsigned int length);
 
   void reconnect()
@@ -101,6 +301,12 @@ namespace Project
 
   void callback(char *topic, byte *message, unsigned int length)
   {
+    if (THIN_CLIENT)
+    {
+      applyDelta(message, length);
+      return;
+    }
+
     DynamicJsonDocument doc(30 * 1024);
     DeserializationError error = deserializeJson(doc, message);
 
@@ -112,249 +318,699 @@ namespace Project
       return;
     }
 
+#ifdef RASTER_BENCHMARK
+    benchmarkRaster();
+#endif
+
     // Drawing all data, functions for that are above
-    display.clearDisplay();
-    drawInfo();
-    drawGrid();
-    drawTime();
     const JsonArray array = doc.as<JsonArray>();
-    drawData(array);
-    display.display();
+    parseEvents(array);
+    showPage();
+    calendar_drawn = true;
   }
 
-  // Function for drawing calendar info
-  void drawInfo()
+  // Packed framebuffer of the current display mode, before rotation
+  uint8_t *framebuffer()
   {
-    // Setting font and color
-    display.setTextColor(0, 7);
-    display.setFont(&FreeSans12pt7b);
-    display.setTextSize(1);
+    return display.getDisplayMode() == INKPLATE_1BIT ? display._partial : display.DMemory4Bit;
+  }
 
-    display.setCursor(20, 20);
+  size_t framebufferSize()
+  {
+    return display.getDisplayMode() == INKPLATE_1BIT ? E_INK_WIDTH * E_INK_HEIGHT / 8 : E_INK_WIDTH * E_INK_HEIGHT / 2;
+  }
 
-    // Print it
-    display.println("Common Calendar");
+  // Direct drawing into a framebuffer of the current display mode
+  Raster target(uint8_t *frame)
+  {
+    return Raster(frame, E_INK_WIDTH, E_INK_HEIGHT, display.getRotation(),
+                  display.getDisplayMode() == INKPLATE_1BIT ? Raster::MONO : Raster::GRAY3);
   }
 
-  // Drawing what time it is
-  void drawTime()
+  // Rasterise a display list into the framebuffer, split between
+  // both cores
+  void renderFrame(const DisplayList &list)
   {
-    // Initial text settings
-    display.setTextColor(0, 7);
-    display.setFont(&FreeSans12pt7b);
-    display.setTextSize(1);
+    render_bands(list, target(framebuffer()));
+  }
 
-    display.setCursor(500, 20);
+  // Chrome for local_date as drawing operations, rebuilt at midnight
+  void buildChrome(const Date &local_date)
+  {
+    static days_t chrome_day = 0;
+    if (chrome_list.size() > 0 && chrome_day == local_date.index())
+    {
+      return;
+    }
+    chrome_day = local_date.index();
+    chrome_list.clear();
+    calendar().drawInfo(chrome_list);
+    calendar().drawGrid(chrome_list, local_date);
+    chrome_layer().invalidate();
+  }
+
+  // Routine updates use 1-bit mode, which has fast partial refreshes.
+  // 3-bit mode is used when something is gray, and for a clean refresh
+  // when the partial updates or the time since the last one run out.
+  void selectMode(bool grayscale)
+  {
+    const char *clean_due = refresh_policy.cleanDue(millis());
+    uint8_t mode = grayscale || clean_due ? INKPLATE_3BIT : INKPLATE_1BIT;
+    if (mode == display.getDisplayMode())
+    {
+      return;
+    }
 
-    // Our function to get time
-    DateTime now = DateTime::local_now(local_tz);
-    display.println(now.format("%c").c_str());
+    // Switching clears the framebuffers, the next push is a full refresh
+    display.selectDisplayMode(mode);
+    frame_diff.reset(mode == INKPLATE_1BIT ? 1 : 4);
+    Serial.printf("mode: %s%s%s\n", mode == INKPLATE_1BIT ? "1-bit" : "3-bit",
+                  grayscale ? ", grayscale content" : clean_due ? ", clean due: " : "",
+                  !grayscale && clean_due ? clean_due : "");
   }
 
-  void draw_error(const String &msg)
+  // Start the frame from the chrome layer, rendering the layer first
+  // if the date, rotation or display mode changed since it was drawn
+  void drawChrome(const Date &local_date)
   {
-    const char *buffer = msg.c_str();
+    FrameLayer &layer = chrome_layer();
+    uint64_t key = ((uint64_t)local_date.index() * 4 + display.getRotation()) * 2 + display.getDisplayMode();
+    if (!layer.valid(key))
+    {
+      // Blank the same way clearDisplay() does
+      uint8_t *frame = layer.redraw(key, framebufferSize());
+      memset(frame, display.getDisplayMode() == INKPLATE_1BIT ? 0 : 0xFF, layer.size());
+      render_bands(chrome_list, target(frame));
+      Serial.println("chrome: redrawn for " + local_date.as_str());
+    }
+    layer.restore(framebuffer());
+  }
 
-    int16_t xt1, yt1;
-    uint16_t w, h;
+  // First day of a page
+  Date pageDate(int page)
+  {
+    return DateTime::local_now(local_tz).date() + page * COLUMNS;
+  }
 
-    // Gets text bounds
-    display.getTextBounds(buffer, 0, 0, &xt1, &yt1, &w, &h);
+  // What a rendered page depends on: its days, the events and how
+  // the framebuffer is laid out
+  uint64_t pageKey(int page)
+  {
+    uint64_t key = ((uint64_t)calendar().generation() << 32) + (uint32_t)pageDate(page).index();
+    return (key * 4 + display.getRotation()) * 2 + display.getDisplayMode();
+  }
 
-    const uint16_t border = 10;
-    const uint16_t x_text = SCREEN_WIDTH / 2 - w / 2;
-    const uint16_t y_text = SCREEN_HEIGHT / 2 + h / 2;
+#if TOUCH_PAGING
+  spare_page *findSparePage(uint64_t key)
+  {
+    spare_page *pages = spare_pages();
+    for (int i = 0; i < SPARE_PAGES; ++i)
+    {
+      if (pages[i].layer->valid(key))
+      {
+        return &pages[i];
+      }
+    }
+    return nullptr;
+  }
+#endif
 
-    const uint16_t x_left = SCREEN_WIDTH / 2 - w / 2 - border;
-    const uint16_t y_top = SCREEN_HEIGHT / 2 - h / 2 - border;
-    const uint16_t width = w + border * 2;
-    const uint16_t height = h + border * 2;
+  // Draw the current page into the framebuffer and push it. A page
+  // rendered ahead of time is used as it is, otherwise it's drawn from
+  // the events.
+  void showPage()
+  {
+    unsigned long start = millis();
+    bool drawn = false;
 
-    display.drawRoundRect(x_left, y_top, width, height, 0, 0);
-    display.setCursor(x_text, y_text);
-    display.print(buffer);
+#if TOUCH_PAGING
+    spare_page *spare = findSparePage(pageKey(page));
+    if (spare != nullptr)
+    {
+      // Only usable if the page doesn't need another display mode
+      selectMode(spare->grayscale);
+      if (spare->layer->valid(pageKey(page)))
+      {
+        spare->layer->restore(framebuffer());
+        shown_layout = spare->layout;
+        drawn = true;
+        Serial.printf("render: page %d rendered ahead, %lu ms\n", page, millis() - start);
+      }
+    }
+#endif
+
+    if (!drawn)
+    {
+      Date begin_date = pageDate(page);
+      buildChrome(begin_date);
+      frame_list.clear();
+      drawData(frame_list, begin_date, shown_layout);
+
+      // Both modes render from the same lists
+      selectMode(chrome_list.grayscale() || frame_list.grayscale());
+
+      start = millis();
+      drawChrome(begin_date);
+      renderFrame(frame_list);
+      Serial.printf("render: page %d, %u ops in %lu ms\n", page, (unsigned)frame_list.size(), millis() - start);
+    }
+
+    // Pages rendered ahead may have events that started or ended
+    // since, and pages are drawn without the clock, it goes on last
+    refreshStatuses(shown_layout, time(nullptr));
+    renderClock();
+    snapshot_stale = true;
+    pushFrame(RefreshPolicy::UNLIMITED);
+
+    // Every page moves on a day at midnight, whenever the zone says
+    // that is
+    Date tomorrow = DateTime::local_now(local_tz).date() + 1;
+    deadlines.schedule(MIDNIGHT, tomorrow.start_of_day(local_tz).epoch_time.epochSeconds);
   }
 
-  // Draw lines in which to put events
-  void drawGrid()
+#if TOUCH_PAGING
+  // Render one of the pages next to the current one if it isn't ready
+  // yet. Returns whether there was one to do.
+  bool renderSparePage()
   {
-    // upper left and low right coordinates
-    int x1 = OUTSIDE_BORDER_WIDTH, y1 = OUTSIDE_BORDER_TOP;
-    int x2 = x1 + COLUMN_WIDTH * COLUMNS, y2 = SCREEN_HEIGHT - OUTSIDE_BORDER_BOTTOM;
+    if (!calendar_drawn)
+    {
+      return false;
+    }
 
-    // Columns and rows
-    int n = 1, m = COLUMNS;
+    const int wanted[SPARE_PAGES] = {page + 1, page - 1};
+    spare_page *pages = spare_pages();
+    for (int want : wanted)
+    {
+      uint64_t key = pageKey(want);
+      if (findSparePage(key) != nullptr)
+      {
+        continue;
+      }
+
+      // Reuse a layer holding neither wanted page
+      spare_page *spare = &pages[0];
+      for (int i = 0; i < SPARE_PAGES; ++i)
+      {
+        if (!pages[i].layer->valid(pageKey(wanted[0])) && !pages[i].layer->valid(pageKey(wanted[1])))
+        {
+          spare = &pages[i];
+          break;
+        }
+      }
+
+      unsigned long start = millis();
+      Date begin_date = pageDate(want);
+      static DisplayList spare_list;
+      spare_list.clear();
+      calendar().drawInfo(spare_list);
+      calendar().drawGrid(spare_list, begin_date);
+      drawData(spare_list, begin_date, spare->layout);
+
+      // Blank the same way clearDisplay() does
+      uint8_t *frame = spare->layer->redraw(key, framebufferSize());
+      memset(frame, display.getDisplayMode() == INKPLATE_1BIT ? 0 : 0xFF, framebufferSize());
+      render_bands(spare_list, target(frame));
+      spare->grayscale = spare_list.grayscale();
+      Serial.printf("page %d: rendered ahead in %lu ms\n", want, millis() - start);
+      return true;
+    }
+    return false;
+  }
+
+  // Show another page, going back to today after a while
+  void flipPage(int to)
+  {
+    page = to;
+    last_page_flip = millis();
+    Serial.printf("page: %d, from %s\n", page, pageDate(page).as_str().c_str());
+    showPage();
+  }
+
+  // Swipe left or tap the right third for later days, swipe right or
+  // tap the left third for earlier ones, tap the middle for today.
+  // Returns whether a gesture finished, and the page it asks for.
+  bool pageTouched(int &to)
+  {
+    static bool down = false;
+    static int start_x = 0, last_x = 0;
+    static unsigned long last_report = 0;
+
+    if (display.tsAvailable())
+    {
+      uint16_t x[2], y[2];
+      if (display.tsGetData(x, y) > 0)
+      {
+        if (!down)
+        {
+          down = true;
+          start_x = x[0];
+        }
+        last_x = x[0];
+        last_report = millis();
+        return false;
+      }
+    }
+    else if (!down || millis() - last_report < TOUCH_RELEASE_MS)
+    {
+      return false;
+    }
+    if (!down)
+    {
+      return false;
+    }
+    down = false;
 
-    // Line drawing
-    display.drawThickLine(x1, y1 + HEADER_HEIGHT, x2, y1 + HEADER_HEIGHT, 0, 2.0);
-    for (int i = 0; i < n + 1; ++i)
+    int dx = last_x - start_x;
+    if (dx <= -SWIPE_MIN_DISTANCE || (dx < SWIPE_MIN_DISTANCE && last_x >= SCREEN_WIDTH * 2 / 3))
     {
-      display.drawThickLine(x1, (int)((float)y1 + (float)i * (float)(y2 - y1) / (float)n), x2,
-                            (int)((float)y1 + (float)i * (float)(y2 - y1) / (float)n), 0, 2.0);
+      to = page + 1;
     }
+    else if (dx >= SWIPE_MIN_DISTANCE || last_x < SCREEN_WIDTH / 3)
+    {
+      to = page - 1;
+    }
+    else
+    {
+      to = 0;
+    }
+    return true;
+  }
+#endif
 
-    for (int i = 0; i < m + 1; ++i)
+  // Send the framebuffer to the panel, the refresh policy decides how.
+  // Changes that would take longer than budget_ms are left in the
+  // framebuffer, and the clean refresh deadline made due to push them.
+  void pushFrame(unsigned long budget_ms)
+  {
+    frame_diff.update(framebuffer());
+
+    const std::vector<Rect> &regions = frame_diff.regions();
+    float dirty = frame_diff.dirty_fraction();
+    Serial.printf("frame: %u/%u tiles dirty in %u regions, %.1f%% of pixels\n",
+                  frame_diff.dirty_tiles(), frame_diff.total_tiles(),
+                  (unsigned)regions.size(), dirty * 100);
+
+    // Partial updates only exist in 1-bit mode. The panel driver diffs
+    // the whole frame itself, the regions only decide whether it's worth it.
+    RefreshPolicy::Decision decision = refresh_policy.decide(display.getDisplayMode() == INKPLATE_1BIT, dirty, budget_ms);
+    Serial.printf("refresh: %s, %s, estimate %lu ms, alternative %lu ms, %u partials covering %.2f screens\n",
+                  RefreshPolicy::name(decision.refresh), decision.reason, decision.estimate_ms,
+                  decision.alternative_ms, refresh_policy.partials(), refresh_policy.partialArea());
+
+    unsigned long start = millis();
+    switch (decision.refresh)
     {
-      display.drawThickLine(
-          x1 + i * COLUMN_WIDTH, y1,
-          x1 + i * COLUMN_WIDTH, y2,
-          0, 2.0);
+    case RefreshPolicy::PARTIAL:
+      display.partialUpdate();
+      break;
+    case RefreshPolicy::FULL_MONO:
+    case RefreshPolicy::FULL_GRAY:
+      display.display();
+      break;
+    default:
+      // Nothing else may push for a while, and a clock tick never fits
+      // the full refresh a ghosting limit forces
+      if (dirty > 0)
+      {
+        scheduleCleanRefresh(0);
+      }
+      return;
     }
+    unsigned long ms = millis() - start;
+    refresh_policy.record(decision.refresh, dirty, ms, millis());
+    frame_diff.commit();
+    scheduleCleanRefresh(refresh_policy.cleanIn(millis()));
 
-    DateTime local_datetime = DateTime::local_now(local_tz);
-    Date local_date = local_datetime.date();
+    const RefreshPolicy::Stats &stats = refresh_policy.stats(decision.refresh);
+    Serial.printf("refresh: %s %lu ms, average %lu ms over %u\n",
+                  RefreshPolicy::name(decision.refresh), ms, stats.total_ms / stats.count, stats.count);
 
-    for (int i = 0; i < m; ++i)
+    if (decision.refresh != RefreshPolicy::PARTIAL || snapshot_stale)
+    {
+      saveSnapshot();
+    }
+    else
     {
-      // Calculate date for column
-      Date date = local_date + i;
+      panel_shows_snapshot = false;
+    }
+  }
 
-      // calculate where to put text and print it
-      display.setFont(&FreeSans9pt7b);
-      display.setCursor(x1 + i * COLUMN_WIDTH + INSIDE_SPACING_WIDTH, y1 + HEADER_HEIGHT - 6);
-      display.println(date.format("%a %d/%h").c_str());
+  // The hourly grayscale refresh has to happen on an idle screen too,
+  // not just when something redraws the page, and so does a push that
+  // was put off. Thin clients leave it to the server.
+  void scheduleCleanRefresh(unsigned long in_ms)
+  {
+    if (THIN_CLIENT)
+    {
+      return;
     }
+    deadlines.schedule(CLEAN_REFRESH, time(nullptr) + (in_ms + 999) / 1000);
   }
 
-  // Function to draw event
-  bool drawEvent(const Date &local_date, const entry &event, int day, int beginY, int max_y, int *y_next)
+  // Save the framebuffer, packed, to flash
+  void saveSnapshot()
   {
-    // Upper left coordinates
-    int x1 = OUTSIDE_BORDER_WIDTH + INSIDE_SPACING_WIDTH + COLUMN_WIDTH * day;
-    int y1 = beginY + INSIDE_SPACING_HEIGHT;
+    panel_shows_snapshot = false;
+    if (!snapshot_storage)
+    {
+      return;
+    }
 
-    int x_text = x1 + EVENT_SPACING_WIDTH;
-    int max_width_text = COLUMN_WIDTH - 2 * INSIDE_SPACING_WIDTH - 2 * EVENT_SPACING_WIDTH;
-    display.setCursor(x_text, y1 + 20 + EVENT_SPACING_HEIGHT);
+    unsigned long start = millis();
+    File file = SPIFFS.open(SNAPSHOT_PATH, FILE_WRITE);
+    if (!file)
+    {
+      Serial.println("snapshot: can't open for writing");
+      return;
+    }
+    // hash is filled in by write_snapshot()
+    snapshot_info info = {(uint8_t)display.getDisplayMode(), (uint8_t)display.getRotation(),
+                          E_INK_WIDTH, E_INK_HEIGHT, (uint32_t)framebufferSize(), 0};
+    size_t bytes = write_snapshot(info, framebuffer(), [&file](const uint8_t *data, size_t len)
+                                  { return file.write(data, len) == len; });
+    file.close();
+
+    if (bytes == 0)
+    {
+      Serial.println("snapshot: write failed");
+      SPIFFS.remove(SNAPSHOT_PATH);
+      return;
+    }
+    snapshot_stale = false;
+    panel_shows_snapshot = true;
+    Serial.printf("snapshot: %u bytes in %lu ms\n", (unsigned)bytes, millis() - start);
+  }
 
-    // Setting text font
-    display.setFont(&FreeSans12pt7b);
+  // Put the saved frame back in the framebuffer, in the display mode
+  // it was saved from
+  bool restoreSnapshot()
+  {
+    if (!snapshot_storage)
+    {
+      return false;
+    }
+    File file = SPIFFS.open(SNAPSHOT_PATH, FILE_READ);
+    if (!file)
+    {
+      return false;
+    }
+    auto source = [&file](uint8_t *buffer, size_t len)
+    { return (size_t)file.read(buffer, len); };
 
+    snapshot_info info;
+    if (!read_snapshot_info(info, source) || info.width != E_INK_WIDTH || info.height != E_INK_HEIGHT ||
+        info.rotation != display.getRotation())
     {
-      // Some temporary variables
-      int n = 0;
-      char line[128];
+      return false;
+    }
 
-      // Insert line brakes into setTextColor
-      int lastSpace = -100;
-      for (int i = 0; i < event.title.length(); ++i)
+    display.selectDisplayMode(info.mode);
+    frame_diff.reset(info.mode == INKPLATE_1BIT ? 1 : 4);
+    if (info.size != framebufferSize() || !read_snapshot_frame(info, framebuffer(), source))
+    {
+      Serial.println("snapshot: corrupt, ignoring");
+      display.clearDisplay();
+      return false;
+    }
+    return true;
+  }
+
+  // Thin client mode: the hash of the framebuffer, for checking the
+  // base of each delta, worked out again when something else changed it
+  uint64_t delta_frame_hash = 0;
+  bool delta_hash_valid = false;
+
+  // Ask the server for a delta with no base
+  void requestKeyFrame()
+  {
+    String topic = String(mqtt_topic) + "/keyframe";
+    client.publish(topic.c_str(), "");
+    Serial.println("delta: asked for a key frame");
+  }
+
+  // Check a delta's header against the framebuffer, switching display
+  // mode if it's for the other one
+  bool startDelta(DeltaDecoder &decoder)
+  {
+    const delta_info &info = decoder.info();
+    if (info.width != E_INK_WIDTH || info.height != E_INK_HEIGHT || info.rotation != display.getRotation())
+    {
+      Serial.printf("delta: for a %ux%u panel at rotation %u, ignoring\n", info.width, info.height, info.rotation);
+      return false;
+    }
+
+    uint8_t mode = info.bits_per_pixel == 1 ? INKPLATE_1BIT : INKPLATE_3BIT;
+    if (mode != display.getDisplayMode())
+    {
+      display.selectDisplayMode(mode);
+      frame_diff.reset(info.bits_per_pixel);
+      delta_hash_valid = false;
+    }
+
+    if (info.base_hash != 0)
+    {
+      if (!delta_hash_valid)
       {
-        // Copy name letter by letter and check if it overflows space given
-        line[n] = event.title[i];
-        if (line[n] == ' ')
-          lastSpace = n;
-        line[++n] = 0;
-
-        int16_t xt1, yt1;
-        uint16_t w, h;
-
-        // Gets text bounds
-        display.getTextBounds(line, 0, 0, &xt1, &yt1, &w, &h);
-        // Serial.printf("'%s' %d %d %d %d %d\n", line, max_width_text, w, w > max_width_text, lastSpace, n - lastSpace);
-
-        // Char out of bounds, put in next line
-        // Note n is now pointing at terminating 0 in line
-        if (w > max_width_text)
-        {
-          if (n - lastSpace - 1 < 15)
-          {
-            // if there was a space 15 chars before, break line there
-            i -= n - lastSpace - 1;
-            line[lastSpace] = 0;
-          }
-          else
-          {
-            // otherwise, break before current character
-            i -= 1;
-            line[n - 1] = 0;
-          }
-
-          // Print text line
-          display.setCursor(x_text, display.getCursorY());
-          display.println(line);
-
-          // Clears line (null termination on first character)
-          line[0] = 0;
-          n = 0;
-        }
+        delta_frame_hash = frame_hash(framebuffer(), info);
+        delta_hash_valid = true;
+      }
+      if (delta_frame_hash != info.base_hash)
+      {
+        Serial.println("delta: based on another frame");
+        return false;
       }
-
-      // display last line
-      display.setCursor(x_text, display.getCursorY());
-      display.println(line);
     }
+    decoder.start(framebuffer());
+    return true;
+  }
 
-    // Set cursor on same y but change x
-    display.setCursor(x_text, display.getCursorY());
-    display.setFont(&FreeSans9pt7b);
+  // Apply framebuffer deltas straight from the message, then push. A
+  // delta may be split over several messages.
+  void applyDelta(const uint8_t *message, size_t length)
+  {
+    // Needs one row besides the framebuffer, allocated on first use
+    static DeltaDecoder decoder(E_INK_WIDTH / 2);
 
-    // Print time
+    unsigned long start = millis();
+    size_t used = 0;
+    while (used < length)
     {
-      String time;
-      unsigned start_days = local_date - event.start_date;
-      time = event.start_time.format("%H:%M");
-      if (start_days > 0)
+      used += decoder.feed(message + used, length - used);
+      if (decoder.ready() && !startDelta(decoder))
+      {
+        decoder.reset();
+        requestKeyFrame();
+        return;
+      }
+      if (decoder.error())
+      {
+        Serial.println("delta: malformed");
+        decoder.reset();
+        delta_hash_valid = false;
+        requestKeyFrame();
+        return;
+      }
+      if (!decoder.done())
       {
-        time = time + "-" + String(start_days);
+        continue;
       }
 
-      unsigned end_days = event.end_date - local_date;
-      time = time + " to " + event.end_time.format("%H:%M");
-      if (end_days > 0)
+      const delta_info &info = decoder.info();
+      delta_frame_hash = frame_hash(framebuffer(), info);
+      delta_hash_valid = true;
+      decoder.reset();
+      if (delta_frame_hash != info.frame_hash)
       {
-        time = time + "+" + String(end_days);
+        Serial.println("delta: result doesn't match");
+        requestKeyFrame();
+        return;
       }
+      Serial.printf("delta: %u tiles in %lu ms\n", info.tile_count, millis() - start);
+      calendar_drawn = true;
+      snapshot_stale = true;
+      pushFrame(RefreshPolicy::UNLIMITED);
+      start = millis();
+    }
+  }
+
+  // Draw the header clock over whatever the framebuffer has there
+  void renderClock()
+  {
+    static DisplayList clock_list;
+    clock_list.clear();
+    calendar().drawTime(clock_list, time(nullptr));
+    renderFrame(clock_list);
 
-      display.print(time);
+    // Shows minutes, so it's out of date at the next one
+    deadlines.schedule(CLOCK_TICK, (time(nullptr) / 60 + 1) * 60);
+  }
+
+  // Redraw just the header clock and push it, the calendar below is
+  // left alone
+  void drawClock()
+  {
+    unsigned long start = millis();
+    renderClock();
+    pushFrame(CLOCK_REFRESH_BUDGET_MS);
+    Serial.printf("clock: %lu ms\n", millis() - start);
+  }
+
+  // Redraw whatever the deadlines due by now put out of date, in one
+  // refresh. Returns whether any were due.
+  bool runDeadlines()
+  {
+    seconds_t now = time(nullptr);
+    bool due[DEADLINES] = {false};
+    bool any = false;
+    unsigned id;
+    while (deadlines.pop(now, id))
+    {
+      due[id] = true;
+      any = true;
+    }
+    if (!any)
+    {
+      return false;
     }
 
-    int bx1 = x1 + 1;
-    int by1 = y1;
-    int bx2 = x1 + COLUMN_WIDTH - INSIDE_SPACING_WIDTH - INSIDE_SPACING_WIDTH - 2;
-    int by2 = display.getCursorY() + EVENT_SPACING_HEIGHT;
+    // A new day moves every column, the whole page is drawn again and
+    // that brings the clock and statuses up to date too. A clean refresh,
+    // or a push that was put off, redraws the page the same way with no
+    // budget, selectMode() switching to 3-bit if a clean is due.
+    if (due[MIDNIGHT] || due[CLEAN_REFRESH])
+    {
+      Serial.println(due[MIDNIGHT] ? "deadline: midnight" : "deadline: clean refresh");
+      showPage();
+      return true;
+    }
 
-    float width = 0;
-    switch (event.status)
+    // Events mostly start and end on the minute, their boxes go out
+    // with the clock tick
+    bool changed = due[STATUS_CHANGE] && refreshStatuses(shown_layout, now);
+    if (due[CLOCK_TICK])
     {
-    case pending:
-      width = 1;
-      break;
-    case in_progress:
-      width = 2;
-      break;
-    case completed:
-      width = 0;
-      break;
-    case cancelled:
-      width = 0;
-      break;
+      drawClock();
     }
+    else if (changed)
+    {
+      pushFrame(RefreshPolicy::UNLIMITED);
+    }
+    return true;
+  }
 
-    // Draw event rect bounds
-    for (int border = 0; border < width; border = border + 1)
+  // Sleep until the next deadline, or for IDLE_SLEEP_MS if that's
+  // sooner. delay() leaves the CPU to the idle task, which can put it
+  // into light sleep.
+  void idle()
+  {
+    unsigned long sleep_ms = IDLE_SLEEP_MS;
+    if (!deadlines.empty())
     {
-      int cx1 = bx1 + border * 4;
-      int cy1 = by1 + border * 4;
-      int cx2 = bx2 - border * 4;
-      int cy2 = by2 - border * 4;
-      display.drawThickLine(cx1, cy1, cx1, cy2, 0, 1);
-      display.drawThickLine(cx1, cy2, cx2, cy2, 0, 1);
-      display.drawThickLine(cx2, cy2, cx2, cy1, 0, 1);
-      display.drawThickLine(cx2, cy1, cx1, cy1, 0, 1);
+      timeval now;
+      gettimeofday(&now, nullptr);
+      long long wait_ms = (deadlines.next() - now.tv_sec) * 1000 - now.tv_usec / 1000;
+      sleep_ms = (unsigned long)std::max(0LL, std::min(wait_ms, (long long)sleep_ms));
     }
+    delay(sleep_ms);
+  }
 
-    // Set how high is the event
-    *y_next = by2 + 1;
+  void draw_error(const String &msg)
+  {
+    const char *buffer = msg.c_str();
+
+    int16_t xt1, yt1;
+    uint16_t w, h;
 
-    // Return is it overflowing
-    return display.getCursorY() < max_y;
+    // Gets text bounds
+    display.getTextBounds(buffer, 0, 0, &xt1, &yt1, &w, &h);
+
+    const uint16_t border = 10;
+    const uint16_t x_text = SCREEN_WIDTH / 2 - w / 2;
+    const uint16_t y_text = SCREEN_HEIGHT / 2 + h / 2;
+
+    const uint16_t x_left = SCREEN_WIDTH / 2 - w / 2 - border;
+    const uint16_t y_top = SCREEN_HEIGHT / 2 - h / 2 - border;
+    const uint16_t width = w + border * 2;
+    const uint16_t height = h + border * 2;
+
+    display.drawRoundRect(x_left, y_top, width, height, 0, 0);
+    display.setCursor(x_text, y_text);
+    display.print(buffer);
   }
 
-  // Struct event comparison function, by timestamp, used for sort later on
-  bool compare_entries(const entry &a, const entry &b)
+#ifdef RASTER_BENCHMARK
+  // Times grid plus a full screen of event borders through GFX, through
+  // the raster kernels on one core and split over both cores. Build
+  // with -DRASTER_BENCHMARK.
+  void benchmarkRaster()
   {
-    return a.start_time < b.start_time;
+    const int iterations = 10;
+    int x1 = OUTSIDE_BORDER_WIDTH, y1 = OUTSIDE_BORDER_TOP;
+    int x2 = x1 + COLUMN_WIDTH * COLUMNS, y2 = SCREEN_HEIGHT - OUTSIDE_BORDER_BOTTOM;
+    const int box_height = 60;
+    const int rows = (y2 - y1 - HEADER_HEIGHT) / box_height;
+
+    unsigned long start = micros();
+    for (int it = 0; it < iterations; ++it)
+    {
+      display.drawThickLine(x1, y1 + HEADER_HEIGHT, x2, y1 + HEADER_HEIGHT, 0, 2.0);
+      display.drawThickLine(x1, y1, x2, y1, 0, 2.0);
+      display.drawThickLine(x1, y2, x2, y2, 0, 2.0);
+      for (int i = 0; i < COLUMNS + 1; ++i)
+      {
+        display.drawThickLine(x1 + i * COLUMN_WIDTH, y1, x1 + i * COLUMN_WIDTH, y2, 0, 2.0);
+      }
+      for (int day = 0; day < COLUMNS; ++day)
+      {
+        for (int row = 0; row < rows; ++row)
+        {
+          int cx1 = x1 + INSIDE_SPACING_WIDTH + COLUMN_WIDTH * day + 1;
+          int cy1 = y1 + HEADER_HEIGHT + row * box_height + INSIDE_SPACING_HEIGHT;
+          int cx2 = cx1 + COLUMN_WIDTH - 2 * INSIDE_SPACING_WIDTH - 3;
+          int cy2 = cy1 + box_height - 2 * INSIDE_SPACING_HEIGHT;
+          display.drawThickLine(cx1, cy1, cx1, cy2, 0, 1);
+          display.drawThickLine(cx1, cy2, cx2, cy2, 0, 1);
+          display.drawThickLine(cx2, cy2, cx2, cy1, 0, 1);
+          display.drawThickLine(cx2, cy1, cx1, cy1, 0, 1);
+        }
+      }
+    }
+    unsigned long gfx = micros() - start;
+
+    DisplayList list;
+    calendar().drawGridLines(list);
+    for (int day = 0; day < COLUMNS; ++day)
+    {
+      for (int row = 0; row < rows; ++row)
+      {
+        int cx1 = x1 + INSIDE_SPACING_WIDTH + COLUMN_WIDTH * day + 1;
+        int cy1 = y1 + HEADER_HEIGHT + row * box_height + INSIDE_SPACING_HEIGHT;
+        int cx2 = cx1 + COLUMN_WIDTH - 2 * INSIDE_SPACING_WIDTH - 3;
+        int cy2 = cy1 + box_height - 2 * INSIDE_SPACING_HEIGHT;
+        CalendarPage::drawBorders(list, cx1, cy1, cx2, cy2, 1);
+      }
+    }
+
+    start = micros();
+    for (int it = 0; it < iterations; ++it)
+    {
+      render_bands(list, target(framebuffer()), 1);
+    }
+    unsigned long kernels = micros() - start;
+
+    start = micros();
+    for (int it = 0; it < iterations; ++it)
+    {
+      renderFrame(list);
+    }
+    unsigned long bands = micros() - start;
+
+    Serial.printf("raster benchmark: grid + %d borders, gfx %lu us, kernels %lu us, both cores %lu us\n",
+                  COLUMNS * rows, gfx / iterations, kernels / iterations, bands / iterations);
+    display.clearDisplay();
   }
+#endif
 
   void convertFromJson(JsonVariantConst src, DateTime &dst)
   {
@@ -369,57 +1025,47 @@ namespace Project
 
   void convertFromJson(JsonVariantConst src, DatePeriod &dst)
   {
-    string str = string(src.as<const char *>());
-    size_t pos;
-
-    pos = str.find(":");
-    if (pos == std::string::npos)
+    const char *src_str = src.as<const char *>();
+    if (src_str == nullptr)
     {
       return;
     }
-    int hours = str.substr(0, pos).as_int();
-    str = str.substr(pos + 1);
 
-    pos = str.find(":");
-    if (pos == std::string::npos)
+    // e.g.: 01:30:00
+    string_ref str(src_str), hours_str, minutes_str;
+    int hours, minutes, seconds;
+    if (!str.split(':', hours_str, str) || !str.split(':', minutes_str, str))
+    {
+      return;
+    }
+    if (!hours_str.to_digits(hours) || !minutes_str.to_digits(minutes) || !str.to_digits(seconds))
     {
       return;
     }
-    int minutes = str.substr(0, pos).as_int();
-    str = str.substr(pos + 1);
-    int seconds = str.as_int();
 
     dst = DatePeriod(0, hours, minutes, seconds);
   }
 
-  // Main data drawing data
-  void drawData(const JsonArray &array)
+  // Keep every event in the message, whichever days they're on, so
+  // that any page can be drawn from them
+  void parseEvents(const JsonArray &array)
   {
-    // calculate begin and end times
-    Serial.println("drawData() begin");
-
-    DateTime utc_datetime = DateTime::utc_now();
-    DateTime local_datetime = utc_datetime.shift_timezone(local_tz);
-    Date begin_date = local_datetime.date();
-    Date end_date = begin_date + COLUMNS;
-    DateTime begin = begin_date.start_of_day(local_tz).shift_timezone(tz_UTC);
-    DateTime end = end_date.start_of_day(local_tz).shift_timezone(tz_UTC);
+    Serial.println("parseEvents() begin");
 
-    Serial.println("utc_datetime: " + utc_datetime.as_str());
-    Serial.println("local_datetime: " + local_datetime.as_str());
-    Serial.println("begin_date/end_date: " + begin_date.as_str() + " / " + end_date.as_str());
-    Serial.println("begin/end: " + begin.as_str() + " / " + end.as_str());
+    // Where to find events by id. The index is allocated on first use,
+    // after PSRAM is up.
+    static EventIndex event_index(MAX_EVENTS);
 
-    // Here we store calendar entries
-    std::vector<entry> entries;
-
-    Serial.println("drawData() parsing entries");
+    event_index.clear();
+    std::vector<entry> events;
+    events.reserve(array.size());
 
     for (JsonVariant src_entry : array)
     {
       // Find all relevant event data.
+      const char *id = src_entry["id"];
       String summary = src_entry["title"];
-      String importance = src_entry["importance"];
+      String importance_str = src_entry["importance"];
       String status_str = src_entry["status"];
       DateTime entry_start_time = src_entry["start_time"];
       // DatePeriod duration = src_entry["required_duration"];
@@ -431,7 +1077,6 @@ namespace Project
       Date entry_start_date = entry_start_time.date();
       Date entry_end_date = entry_end_time.date();
 
-      int day = entry_start_date - begin_date;
       status_t status;
 
       if (status_str == "Completed")
@@ -451,29 +1096,53 @@ namespace Project
         status = pending;
       }
 
-      // If entry already started but not finished, then set to day 0.
-      if (day < 0 && entry_end_date >= begin_date)
+      // Higher is more important, anything unknown counts as medium
+      int importance;
+      if (src_entry["importance"].is<int>())
       {
-        day = 0;
+        importance = src_entry["importance"];
+      }
+      else if (importance_str == "Low")
+      {
+        importance = 0;
+      }
+      else if (importance_str == "High")
+      {
+        importance = 2;
+      }
+      else if (importance_str == "Urgent" || importance_str == "Critical")
+      {
+        importance = 3;
+      }
+      else
+      {
+        importance = 1;
       }
 
-      // Fill in our struct with data.
-      struct entry entry(summary, entry_start_time, entry_end_time, entry_start_date, entry_end_date, day, status);
+      // Fill in our struct with data, the day column depends on the page
+      struct entry entry(summary, entry_start_time, entry_end_time, entry_start_date, entry_end_date, 0, status, importance);
+
+      Serial.println("----------");
+      unsigned slot = events.size();
+      if (id != nullptr)
+      {
+        slot = event_index.insert(id, slot);
+      }
 
-      // If entry within date bounds, add to list.
-      if (entry.day >= 0 && entry.day < COLUMNS)
+      if (slot < events.size())
       {
-        Serial.println("----------");
-        entries.push_back(entry);
+        // Same id seen before, the later copy wins
+        Serial.println("replacing duplicate " + String(id));
+        events[slot] = entry;
       }
       else
       {
-        Serial.println("++++++++++");
+        events.push_back(entry);
       }
 
-      Serial.println("DAY " + String(entry.day));
       Serial.println("summary " + entry.title);
       Serial.println("status " + status_str + " " + String(entry.status));
+      Serial.println("importance " + importance_str + " " + String(entry.importance));
       Serial.println("start " + entry.start_time.as_str());
       Serial.println("start " + entry.start_date.as_str());
       Serial.println("end " + entry.end_time.as_str());
@@ -481,56 +1150,62 @@ namespace Project
       Serial.println();
     }
 
-    // Sort entries by time
-    // Serial.println("drawData() sorting");
-    // sort(entries.begin(), entries.end(), compare_entries);
+    Serial.printf("parseEvents() %u events\n", (unsigned)events.size());
+    calendar().setEvents(std::move(events));
+  }
 
-    // Events displayed and overflown counters
-    int columns[COLUMNS] = {0};
-    int cloggedCount[COLUMNS] = {0};
+  // Draw the events of the page of COLUMNS days from begin_date, with
+  // their status as of now. What was drawn where goes in layout.
+  void drawData(DisplayList &list, const Date &begin_date, page_layout &layout)
+  {
+    Serial.println("begin_date/end_date: " + begin_date.as_str() + " / " + (begin_date + COLUMNS).as_str());
+    calendar().drawData(list, begin_date, time(nullptr), layout);
 
-    for (int i = 0; i < COLUMNS; ++i)
+    for (unsigned slot : layout.hidden)
     {
-      columns[i] = OUTSIDE_BORDER_TOP + HEADER_HEIGHT + 1;
+      const entry &event = layout.entries[slot];
+      Serial.println("hiding " + event.title + " on day " + String(event.day) + ", importance " + String(event.importance));
     }
-
-    // Displaying events one by one
-    for (auto entry : entries)
+    if (TIME_GRID)
     {
-      // If column overflowed just add event to not shown
-      if (cloggedCount[entry.day] > 0)
-      {
-        ++cloggedCount[entry.day];
-        continue;
-      }
+      Serial.printf("time grid: %u events in %u boxes\n", (unsigned)layout.entries.size(), (unsigned)layout.grid_boxes.size());
+    }
 
-      // We store how much height did one event take up
-      int y_pos = 0;
-      Date local_date = local_datetime.date() + entry.day;
-      bool s = drawEvent(local_date, entry, entry.day, columns[entry.day], SCREEN_HEIGHT - OUTSIDE_BORDER_BOTTOM, &y_pos);
-      columns[entry.day] = y_pos;
+    const LayoutCache::Stats &stats = layout_cache().stats();
+    Serial.printf("layout cache: %u hits, %u misses, %u evictions, %u uncached, %u/%u used\n",
+                  stats.hits, stats.misses, stats.evictions, stats.uncached,
+                  (unsigned)layout_cache().size(), (unsigned)layout_cache().capacity());
+    layout_cache().reset_stats();
+  }
 
-      // If it overflowed, set column to clogged and add one event as not shown
-      if (!s)
-      {
-        ++cloggedCount[entry.day];
-      }
+  // Redraw the boxes of events on a page whose status has changed by
+  // now, leaving the rest of the page alone, and wait for the next one
+  // to change. Returns whether any box was redrawn.
+  bool refreshStatuses(page_layout &layout, seconds_t now)
+  {
+    static DisplayList status_list;
+    status_list.clear();
+
+    seconds_t next_change;
+    unsigned redrawn = calendar().refreshStatuses(status_list, layout, now, next_change);
+    if (next_change != 0)
+    {
+      deadlines.schedule(STATUS_CHANGE, next_change);
+    }
+    else
+    {
+      deadlines.cancel(STATUS_CHANGE);
     }
 
-    // Display not shown events info
-    for (int i = 0; i < COLUMNS; ++i)
+    if (redrawn == 0)
     {
-      if (cloggedCount[i])
-      {
-        // Draw notification showing that there are more events than drawn ones
-        display.fillRoundRect(OUTSIDE_BORDER_WIDTH + i * COLUMN_WIDTH + INSIDE_SPACING_WIDTH, SCREEN_HEIGHT - OUTSIDE_BORDER_BOTTOM - INSIDE_SPACING_WIDTH - 24, COLUMN_WIDTH - 2 * INSIDE_SPACING_WIDTH, 20, 10, 0);
-        display.setCursor(OUTSIDE_BORDER_WIDTH + i * COLUMN_WIDTH + INSIDE_SPACING_WIDTH + 10, SCREEN_HEIGHT - OUTSIDE_BORDER_BOTTOM - INSIDE_SPACING_WIDTH - 24 + 15);
-        display.setTextColor(7, 0);
-        display.setFont(&FreeSans9pt7b);
-        display.print(cloggedCount[i]);
-        display.print(" more events");
-      }
+      return false;
     }
+    renderFrame(status_list);
+    snapshot_stale = true;
+    Serial.printf("status: %u boxes redrawn, next change in %ld s\n", redrawn,
+                  next_change != 0 ? (long)(next_change - now) : -1L);
+    return true;
   }
 }
 
@@ -549,7 +1224,60 @@ void setup()
   display.setTextWrap(false);
   display.setTextColor(0, 7);
 
-  if (!refreshed)
+#if TOUCH_PAGING
+  if (!display.tsInit(true))
+  {
+    Serial.println("Touchscreen init failed, paging disabled.");
+  }
+#endif
+
+  // Expand ASCII into PSRAM now rather than on the first frame, other
+  // glyphs are added as titles use them
+  size_t atlas_bytes = 0;
+  for (const FontMetrics *font : {&titleFont(), &smallFont()})
+  {
+    for (Raster::Format format : {Raster::GRAY3, Raster::MONO})
+    {
+      GlyphAtlas &atlas = GlyphAtlas::get(*font, ROTATION, format);
+      for (uint32_t codepoint = ' '; codepoint <= '~'; ++codepoint)
+      {
+        const FontMetrics::glyph_metrics *glyph = font->glyph(codepoint);
+        if (glyph != nullptr)
+        {
+          atlas.add(glyph);
+        }
+      }
+      atlas_bytes += atlas.bytes();
+    }
+  }
+  Serial.printf("glyph atlas: %u bytes\n", (unsigned)atlas_bytes);
+
+  // Last frame first, the calendar will be brought up to date once
+  // data arrives
+  snapshot_storage = SPIFFS.begin(true);
+  unsigned long restore_start = millis();
+  if (restoreSnapshot())
+  {
+    if (panel_shows_snapshot)
+    {
+      // Woken from sleep with the frame still on the panel. In 1-bit
+      // mode partial updates compare against the last frame shown.
+      if (display.getDisplayMode() == INKPLATE_1BIT)
+      {
+        memcpy(display.DMemoryNew, display._partial, framebufferSize());
+      }
+      Serial.printf("snapshot: restored in %lu ms, already on the panel\n", millis() - restore_start);
+    }
+    else
+    {
+      display.display();
+      panel_shows_snapshot = true;
+      Serial.printf("snapshot: restored and shown in %lu ms\n", millis() - restore_start);
+    }
+    frame_diff.update(framebuffer());
+    frame_diff.commit();
+  }
+  else if (!refreshed)
   {
     // Welcome screen
     Serial.println("Drawing welcome screen.");
@@ -559,6 +1287,7 @@ void setup()
     display.setCursor(5, 250);
     display.println(F("Connecting to WiFi..."));
     display.display();
+    panel_shows_snapshot = false;
   }
 
   Serial.println("Going to sleep.");
@@ -595,4 +1324,33 @@ void loop()
     reconnect();
   }
   client.loop();
+
+  // Redraw whatever time has put out of date, thin clients get it all
+  // from the server
+  if (calendar_drawn && runDeadlines())
+  {
+    return;
+  }
+
+#if TOUCH_PAGING
+  int to;
+  if (calendar_drawn && pageTouched(to))
+  {
+    flipPage(to);
+    return;
+  }
+  if (page != 0 && millis() - last_page_flip >= PAGE_TIMEOUT_MS)
+  {
+    flipPage(0);
+    return;
+  }
+
+  // Nothing else to do, get the next pages ready
+  if (renderSparePage())
+  {
+    return;
+  }
+#endif
+
+  idle();
 }
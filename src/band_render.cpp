@@ -0,0 +1,113 @@
+#include "band_render.h"
+
+#ifdef ARDUINO
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#else
+#include <thread>
+#include <vector>
+#endif
+
+namespace Project
+{
+    namespace
+    {
+        // Panel rows per stripe; a multiple of 32 keeps stripes aligned
+        // with the frame_diff tiles
+        const int BAND_ROWS = 64;
+
+        struct band_job
+        {
+            const DisplayList *list;
+            const Raster *target;
+            unsigned worker;
+            unsigned workers;
+#ifdef ARDUINO
+            SemaphoreHandle_t done;
+#endif
+        };
+
+        void render_stripes(const band_job &job)
+        {
+            Raster raster = *job.target;
+            for (int y = job.worker * BAND_ROWS; y < raster.panelHeight(); y += job.workers * BAND_ROWS)
+            {
+                raster.setClip(y, y + BAND_ROWS);
+                job.list->render(raster);
+            }
+        }
+
+#ifdef ARDUINO
+        void band_task(void *arg)
+        {
+            band_job *job = static_cast<band_job *>(arg);
+            render_stripes(*job);
+            xSemaphoreGive(job->done);
+            vTaskDelete(nullptr);
+        }
+#endif
+    }
+
+#ifdef ARDUINO
+    void render_bands(const DisplayList &list, const Raster &target, unsigned workers)
+    {
+        list.prepare(target);
+
+        band_job main_job = {&list, &target, 0, 2, nullptr};
+        band_job other_job = main_job;
+        other_job.worker = 1;
+        other_job.done = xSemaphoreCreateBinary();
+
+        // Fall back to doing every stripe here if the task can't start
+        if (workers == 1 || other_job.done == nullptr ||
+            xTaskCreatePinnedToCore(band_task, "band", 4096, &other_job, uxTaskPriorityGet(nullptr),
+                                    nullptr, 1 - xPortGetCoreID()) != pdPASS)
+        {
+            main_job.workers = 1;
+            render_stripes(main_job);
+            if (other_job.done != nullptr)
+            {
+                vSemaphoreDelete(other_job.done);
+            }
+            return;
+        }
+
+        render_stripes(main_job);
+        xSemaphoreTake(other_job.done, portMAX_DELAY);
+        vSemaphoreDelete(other_job.done);
+    }
+#else
+    void render_bands(const DisplayList &list, const Raster &target, unsigned workers)
+    {
+        list.prepare(target);
+
+        if (workers == 0)
+        {
+            workers = std::thread::hardware_concurrency();
+        }
+        unsigned stripes = (target.panelHeight() + BAND_ROWS - 1) / BAND_ROWS;
+        if (workers > stripes)
+        {
+            workers = stripes;
+        }
+        if (workers == 0)
+        {
+            workers = 1;
+        }
+
+        std::vector<std::thread> threads;
+        threads.reserve(workers - 1);
+        for (unsigned worker = 1; worker < workers; ++worker)
+        {
+            band_job job = {&list, &target, worker, workers};
+            threads.emplace_back(render_stripes, job);
+        }
+        render_stripes(band_job{&list, &target, 0, workers});
+        for (std::thread &thread : threads)
+        {
+            thread.join();
+        }
+    }
+#endif
+}
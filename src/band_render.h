@@ -0,0 +1,20 @@
+#ifndef band_render_h
+#define band_render_h
+
+#include "display_list.h"
+#include "raster.h"
+
+namespace Project
+{
+    // Renders a display list into target's framebuffer split into
+    // horizontal panel stripes. Stripes are dealt out round-robin, so
+    // busy parts of the screen are shared between workers, and each
+    // worker only writes its own rows. Returns once every stripe is done.
+    //
+    // On the ESP32 the second worker is a task pinned to the core not
+    // running loop(); elsewhere workers are threads, one per hardware
+    // thread unless workers says otherwise.
+    void render_bands(const DisplayList &list, const Raster &target, unsigned workers = 0);
+}
+
+#endif
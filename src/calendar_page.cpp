@@ -0,0 +1,555 @@
+#include "calendar_page.h"
+
+#include <algorithm>
+#include <climits>
+
+#include "tz.h"
+
+namespace Project
+{
+    entry::entry(const string &summary, const DateTime &start_time, const DateTime &end_time, const Date &start_date,
+                 const Date &end_date, int day, status_t status, int importance)
+        : title(summary), start_time(start_time), end_time(end_time), start_date(start_date), end_date(end_date),
+          day(day), status(status), importance(importance)
+    {
+    }
+
+    // Width of text as drawn
+    static int textWidth(const FontMetrics &font, const string_ref &text)
+    {
+        TextExtent extent;
+        size_t pos = 0;
+        while (pos < text.length())
+        {
+            const FontMetrics::glyph_metrics *glyph = font.glyph(next_codepoint(text, pos));
+            if (glyph != nullptr)
+            {
+                extent.add(glyph);
+            }
+        }
+        return extent.width();
+    }
+
+    CalendarPage::CalendarPage(const page_style &style, LayoutCache &cache, TZ_ptr tz)
+        : page(style), cache(cache), tz(tz), events_generation(0)
+    {
+    }
+
+    void CalendarPage::setEvents(std::vector<entry> &&events)
+    {
+        this->all_events = std::move(events);
+        this->event_ranges.clear();
+        this->event_ranges.reserve(this->all_events.size());
+        for (unsigned slot = 0; slot < this->all_events.size(); ++slot)
+        {
+            const entry &event = this->all_events[slot];
+            this->event_ranges.add(event.start_time.epoch_time.epochSeconds, event.end_time.epoch_time.epochSeconds, slot);
+        }
+        this->event_ranges.build();
+        ++this->events_generation;
+    }
+
+    // Function for drawing calendar info
+    void CalendarPage::drawInfo(DisplayList &list) const
+    {
+        list.text(*this->page.title_font, 20, 20, "Common Calendar", 0);
+    }
+
+    // Drawing what time it is, over whatever is in the clock area. The
+    // clock ticks once a minute so leave out the seconds.
+    void CalendarPage::drawTime(DisplayList &list, seconds_t now) const
+    {
+        const page_style &s = this->page;
+        list.fillRect(s.clock_x, 0, s.width - s.clock_x, s.border_top - 2, 7);
+        list.text(*s.title_font, s.clock_x, s.clock_y, DateTime(now, this->tz).format("%a %b %e %H:%M %Y"), 0);
+    }
+
+    // Grid lines around the header and between the columns
+    void CalendarPage::drawGridLines(DisplayList &list) const
+    {
+        const page_style &s = this->page;
+
+        // upper left and low right coordinates
+        int x1 = s.border_width, y1 = s.border_top;
+        int x2 = x1 + s.column_width * s.columns, y2 = s.height - s.border_bottom;
+
+        list.hline(x1, y1, x2 - x1 + 1, 0, 2);
+        list.hline(x1, y1 + s.header_height, x2 - x1 + 1, 0, 2);
+        list.hline(x1, y2, x2 - x1 + 1, 0, 2);
+
+        for (int i = 0; i < s.columns + 1; ++i)
+        {
+            list.vline(x1 + i * s.column_width, y1, y2 - y1 + 1, 0, 2);
+        }
+    }
+
+    // Event box outline, one nested rectangle per border
+    void CalendarPage::drawBorders(DisplayList &list, int bx1, int by1, int bx2, int by2, int borders)
+    {
+        for (int border = 0; border < borders; border = border + 1)
+        {
+            int inset = border * 4;
+            list.rect(bx1 + inset, by1 + inset, bx2 - bx1 + 1 - 2 * inset, by2 - by1 + 1 - 2 * inset, 0);
+        }
+    }
+
+    // Top and bottom of the hour axis in the time grid view
+    int CalendarPage::gridTop() const
+    {
+        return this->page.border_top + this->page.header_height + 1;
+    }
+
+    int CalendarPage::gridBottom() const
+    {
+        return this->page.height - this->page.border_bottom - 1;
+    }
+
+    // Where a time of day, in seconds, goes on the hour axis
+    int CalendarPage::gridY(seconds_t seconds) const
+    {
+        const seconds_t first = this->page.first_hour * 3600, last = this->page.last_hour * 3600;
+        seconds = std::min(std::max(seconds, first), last);
+        return this->gridTop() + (seconds - first) * (this->gridBottom() - this->gridTop()) / (last - first);
+    }
+
+    // Light lines and labels for each hour of the time grid
+    void CalendarPage::drawHourLines(DisplayList &list) const
+    {
+        const page_style &s = this->page;
+        int x1 = s.border_width;
+        int x2 = x1 + s.column_width * s.columns;
+
+        for (int hour = s.first_hour + 1; hour < s.last_hour; ++hour)
+        {
+            int y = this->gridY(hour * 3600);
+            list.hline(x1, y, x2 - x1, 5);
+            list.text(*s.small_font, x1 + s.inside_spacing_width, y - 2, string::fmt("%d", hour), 4);
+        }
+    }
+
+    // Draw lines in which to put events
+    void CalendarPage::drawGrid(DisplayList &list, const Date &local_date) const
+    {
+        const page_style &s = this->page;
+
+        // upper left coordinates
+        int x1 = s.border_width, y1 = s.border_top;
+
+        this->drawGridLines(list);
+        if (s.time_grid)
+        {
+            this->drawHourLines(list);
+        }
+
+        for (int i = 0; i < s.columns; ++i)
+        {
+            // Calculate date for column
+            Date date = local_date + i;
+
+            // calculate where to put text and print it
+            list.text(*s.small_font, x1 + i * s.column_width + s.inside_spacing_width, y1 + s.header_height - 6,
+                      date.format("%a %d/%h"), 0);
+        }
+    }
+
+    // Function to work out the size of an event box without drawing it
+    void CalendarPage::measureEvent(const entry &event, int beginY, std::vector<TextLine> &lines, event_box &box)
+    {
+        const page_style &s = this->page;
+
+        // Break title into lines that fit the box, unchanged titles
+        // come straight from the cache
+        const int max_width_text = s.column_width - 2 * s.inside_spacing_width - 2 * s.event_spacing_width;
+        TextLayout layout = this->cache.layout(*s.title_font, event.title, max_width_text);
+
+        box.day = event.day;
+        box.y_top = beginY;
+        box.first_line = lines.size();
+        box.line_count = layout.count;
+        lines.insert(lines.end(), layout.lines, layout.lines + layout.count);
+
+        // Title baseline, one line per title line, then the time line
+        int y1 = beginY + s.inside_spacing_height;
+        int time_y = y1 + 20 + s.event_spacing_height + layout.height;
+        box.y_bottom = time_y + s.event_spacing_height;
+    }
+
+    // Function to draw event
+    void CalendarPage::drawEvent(DisplayList &list, const Date &local_date, const entry &event, const event_box &box,
+                                 const std::vector<TextLine> &lines) const
+    {
+        const page_style &s = this->page;
+
+        // Upper left coordinates
+        int x1 = s.border_width + s.inside_spacing_width + s.column_width * box.day;
+        int y1 = box.y_top + s.inside_spacing_height;
+
+        int x_text = x1 + s.event_spacing_width;
+        int y_text = y1 + 20 + s.event_spacing_height;
+
+        const FontMetrics &title_font = *s.title_font;
+        string_ref title(event.title);
+        for (unsigned i = 0; i < box.line_count; ++i)
+        {
+            const TextLine &line = lines[box.first_line + i];
+            list.text(title_font, x_text, y_text, title.substr(line.offset, line.length), 0);
+            y_text += title_font.yAdvance();
+        }
+
+        // Print time
+        {
+            string time;
+            unsigned start_days = local_date - event.start_date;
+            time = event.start_time.format("%H:%M");
+            if (start_days > 0)
+            {
+                time = time + "-" + string::fmt("%u", start_days);
+            }
+
+            unsigned end_days = event.end_date - local_date;
+            time = time + " to " + event.end_time.format("%H:%M");
+            if (end_days > 0)
+            {
+                time = time + "+" + string::fmt("%u", end_days);
+            }
+
+            list.text(*s.small_font, x_text, y_text, time, 0);
+        }
+
+        int bx1 = x1 + 1;
+        int by1 = y1;
+        int bx2 = x1 + s.column_width - s.inside_spacing_width - s.inside_spacing_width - 2;
+        int by2 = box.y_bottom;
+
+        int width = 0;
+        switch (event.status)
+        {
+        case pending:
+            width = 1;
+            break;
+        case in_progress:
+            width = 2;
+            break;
+        case completed:
+            width = 0;
+            break;
+        case cancelled:
+            width = 0;
+            break;
+        }
+
+        // Draw event rect bounds
+        drawBorders(list, bx1, by1, bx2, by2, width);
+    }
+
+    // Main data drawing data, the page of columns days from begin_date.
+    // If a column's events don't all fit, the most important ones that
+    // fit above a badge saying how many are hidden are kept, in time
+    // order.
+    void CalendarPage::drawData(DisplayList &list, const Date &begin_date, seconds_t now, page_layout &layout)
+    {
+        const page_style &s = this->page;
+
+        // calculate begin and end times
+        Date end_date = begin_date + s.columns;
+        DateTime begin = begin_date.start_of_day(this->tz).shift_timezone(tz_UTC);
+        DateTime end = end_date.start_of_day(this->tz).shift_timezone(tz_UTC);
+
+        // The events on this page, in start order, with their day column
+        // and status as of now. Events that started before the page go in
+        // the first column.
+        std::vector<entry> &entries = layout.entries;
+        std::vector<unsigned> &slots = this->slots;
+        EventOrder &order = this->order;
+
+        layout.begin_date = begin_date;
+        layout.grid_boxes.clear();
+        layout.hidden.clear();
+        entries.clear();
+        slots.clear();
+        this->event_ranges.query(begin.epoch_time.epochSeconds, end.epoch_time.epochSeconds, slots);
+        entries.reserve(slots.size());
+        for (unsigned slot : slots)
+        {
+            entries.push_back(this->all_events[slot]);
+            int day = entries.back().start_date - begin_date;
+            entries.back().day = std::max(day, 0);
+            entries.back().status = statusAt(this->all_events[slot], now);
+        }
+
+        if (s.time_grid)
+        {
+            layout.boxes.clear();
+            layout.lines.clear();
+            this->drawTimeGrid(list, layout);
+            return;
+        }
+
+        // Sort entries by column then time
+        order.clear();
+        order.reserve(entries.size());
+        for (unsigned slot = 0; slot < entries.size(); ++slot)
+        {
+            seconds_t start_offset = entries[slot].start_time.epoch_time - begin.epoch_time;
+            order.add(make_sort_key(entries[slot].day, start_offset, slot), slot);
+        }
+        order.sort();
+
+        // Layout pass: measure every event in a column, then choose which
+        // to keep if they don't all fit
+        const int column_top = s.border_top + s.header_height + 1;
+        const int column_bottom = s.height - s.border_bottom - 1;
+        const int badge_top = s.height - s.border_bottom - s.inside_spacing_width - 24;
+
+        std::vector<TextLine> &lines = layout.lines;
+        std::vector<event_box> &boxes = layout.boxes;
+        this->hidden_count.assign(s.columns, 0);
+        this->less_important.assign(s.columns, 0);
+        lines.clear();
+        boxes.clear();
+
+        for (int day = 0; day < s.columns; ++day)
+        {
+            size_t first, last;
+            order.column(day, first, last);
+
+            size_t column_start = boxes.size();
+            int y = column_top;
+            for (size_t i = first; i < last; ++i)
+            {
+                event_box box;
+                box.slot = order[i].slot;
+                this->measureEvent(entries[box.slot], y, lines, box);
+                boxes.push_back(box);
+                y = box.y_bottom + 1;
+            }
+
+            if (y - 1 <= column_bottom)
+            {
+                continue;
+            }
+
+            std::vector<select_item> &items = this->items;
+            std::vector<unsigned> &kept = this->kept;
+            items.clear();
+            for (size_t i = column_start; i < boxes.size(); ++i)
+            {
+                items.push_back(select_item{entries[boxes[i].slot].importance, boxes[i].y_bottom - boxes[i].y_top + 1});
+            }
+            select_important(items, badge_top - column_top, kept);
+
+            // Hidden events less important than every one shown were dropped
+            // for that, the rest for want of room
+            int lowest_kept = kept.empty() ? INT_MIN : INT_MAX;
+            for (unsigned k : kept)
+            {
+                lowest_kept = std::min(lowest_kept, items[k].importance);
+            }
+
+            // Close up the gaps left by hidden events
+            size_t visible = column_start, next = 0;
+            y = column_top;
+            for (size_t i = 0; i < items.size(); ++i)
+            {
+                event_box box = boxes[column_start + i];
+                if (next < kept.size() && kept[next] == i)
+                {
+                    ++next;
+                    box.y_bottom += y - box.y_top;
+                    box.y_top = y;
+                    y = box.y_bottom + 1;
+                    boxes[visible++] = box;
+                    continue;
+                }
+
+                this->less_important[day] += items[i].importance < lowest_kept;
+                layout.hidden.push_back(box.slot);
+            }
+            this->hidden_count[day] = boxes.size() - visible;
+            boxes.resize(visible);
+        }
+
+        // Draw pass, only events that fit
+        for (const event_box &box : boxes)
+        {
+            Date local_date = begin_date + box.day;
+            this->drawEvent(list, local_date, entries[box.slot], box, lines);
+        }
+
+        // Display not shown events info
+        const FontMetrics &small_font = *s.small_font;
+        for (int i = 0; i < s.columns; ++i)
+        {
+            if (this->hidden_count[i])
+            {
+                // Draw notification showing that there are more events than drawn ones
+                list.fillRoundRect(s.border_width + i * s.column_width + s.inside_spacing_width, badge_top,
+                                   s.column_width - 2 * s.inside_spacing_width, 20, 10, 0);
+                // Say how many were hidden for being less important, as much
+                // of it as fits
+                string more = string::fmt("%d more", this->hidden_count[i]);
+                string less = string::fmt("%d less important", this->less_important[i]);
+                string badges[] = {more + " events, " + less, more + ", " + less, more + " events", more};
+                int room = s.column_width - 2 * s.inside_spacing_width - 20;
+                unsigned choice = this->less_important[i] > 0 ? 0 : 2;
+                while (choice + 1 < sizeof(badges) / sizeof(badges[0]) && textWidth(small_font, badges[choice]) > room)
+                {
+                    ++choice;
+                }
+                list.text(small_font, s.border_width + i * s.column_width + s.inside_spacing_width + 10, badge_top + 15,
+                          badges[choice], 7);
+            }
+        }
+    }
+
+    // Time grid view: boxes sized by start and end time, overlapping
+    // events side by side, events over several days in every column
+    // they cover
+    void CalendarPage::drawTimeGrid(DisplayList &list, page_layout &layout)
+    {
+        const page_style &s = this->page;
+        const std::vector<entry> &entries = layout.entries;
+
+        this->day_starts.resize(s.columns + 1);
+        for (int i = 0; i <= s.columns; ++i)
+        {
+            this->day_starts[i] = (layout.begin_date + i).start_of_day(this->tz).epoch_time.epochSeconds;
+        }
+
+        // Short events still get room for a line of text
+        const int min_height = 20;
+        this->grid.setMinDuration((seconds_t)min_height * (s.last_hour - s.first_hour) * 3600 /
+                                  (this->gridBottom() - this->gridTop()));
+        this->grid.reset(this->day_starts.data(), s.columns);
+        for (unsigned slot = 0; slot < entries.size(); ++slot)
+        {
+            this->grid.add(entries[slot].start_time.epoch_time.epochSeconds, entries[slot].end_time.epoch_time.epochSeconds, slot);
+        }
+        this->grid.pack();
+
+        const int inner_width = s.column_width - 2 * s.inside_spacing_width - 2;
+
+        for (size_t i = 0; i < this->grid.size(); ++i)
+        {
+            const TimeGrid::span &span = this->grid[i];
+
+            grid_box box;
+            int lane_width = inner_width / span.lanes;
+            box.slot = span.slot;
+            box.x1 = s.border_width + s.inside_spacing_width + s.column_width * span.day + 1 + span.lane * lane_width;
+            box.x2 = box.x1 + lane_width - 2;
+            box.y1 = this->gridY(span.start);
+            box.y2 = std::max(this->gridY(span.end) - 1, box.y1 + 1);
+
+            this->drawGridBox(list, entries[span.slot], box);
+            layout.grid_boxes.push_back(box);
+        }
+    }
+
+    // One time grid box, over whatever was there before
+    void CalendarPage::drawGridBox(DisplayList &list, const entry &event, const grid_box &box)
+    {
+        const page_style &s = this->page;
+
+        // Cover the hour lines behind the box
+        list.fillRect(box.x1, box.y1, box.x2 - box.x1 + 1, box.y2 - box.y1 + 1, 7);
+        drawBorders(list, box.x1, box.y1, box.x2, box.y2, event.status == pending ? 1 : event.status == in_progress ? 2 : 0);
+
+        // As many title lines as fit in the box
+        const FontMetrics &font = *s.small_font;
+        string_ref title(event.title);
+        TextLayout layout = this->cache.layout(font, title, box.x2 - box.x1 + 1 - 2 * s.inside_spacing_width);
+        int y_text = box.y1 + s.inside_spacing_height + 13;
+        for (unsigned line = 0; line < layout.count && y_text + 4 <= box.y2; ++line)
+        {
+            const TextLine &text = layout.lines[line];
+            list.text(font, box.x1 + s.inside_spacing_width, y_text, title.substr(text.offset, text.length), 0);
+            y_text += font.yAdvance();
+        }
+    }
+
+    // What an event's status is at a given time. Cancelled and completed
+    // come from the server and stand whatever the time says, in progress
+    // from the server means it started early. Otherwise it's pending until
+    // the start time and completed from the end time. A status worked out
+    // by this goes back in as the same status later on, so statuses drawn
+    // on a page can be brought up to date without the server's.
+    status_t CalendarPage::statusAt(const entry &event, seconds_t now)
+    {
+        if (event.status == cancelled || event.status == completed)
+        {
+            return event.status;
+        }
+        if (now >= event.end_time.epoch_time.epochSeconds)
+        {
+            return completed;
+        }
+        if (event.status == in_progress || now >= event.start_time.epoch_time.epochSeconds)
+        {
+            return in_progress;
+        }
+        return pending;
+    }
+
+    // When statusAt() next gives something else for an event, 0 if never
+    seconds_t CalendarPage::nextStatusChange(const entry &event, seconds_t now)
+    {
+        switch (statusAt(event, now))
+        {
+        case pending:
+            return event.start_time.epoch_time.epochSeconds;
+        case in_progress:
+            return event.end_time.epoch_time.epochSeconds;
+        default:
+            return 0;
+        }
+    }
+
+    // Redraw the boxes whose status has changed, leaving the rest of the
+    // page alone
+    unsigned CalendarPage::refreshStatuses(DisplayList &list, page_layout &layout, seconds_t now, seconds_t &next_change)
+    {
+        const page_style &s = this->page;
+
+        // Events hidden for want of room count too, they just have no box
+        std::vector<entry> &entries = layout.entries;
+        std::vector<bool> &changed = this->changed;
+        changed.assign(entries.size(), false);
+        next_change = 0;
+        for (size_t slot = 0; slot < entries.size(); ++slot)
+        {
+            status_t status = statusAt(entries[slot], now);
+            changed[slot] = status != entries[slot].status;
+            entries[slot].status = status;
+
+            seconds_t next = nextStatusChange(entries[slot], now);
+            if (next != 0 && (next_change == 0 || next < next_change))
+            {
+                next_change = next;
+            }
+        }
+
+        unsigned redrawn = 0;
+        for (const event_box &box : layout.boxes)
+        {
+            if (changed[box.slot])
+            {
+                // Blank the box the way drawEvent() bounds it, then draw it again
+                int x1 = s.border_width + s.inside_spacing_width + s.column_width * box.day;
+                int y1 = box.y_top + s.inside_spacing_height;
+                list.fillRect(x1 + 1, y1, s.column_width - 2 * s.inside_spacing_width - 2, box.y_bottom - y1 + 1, 7);
+                this->drawEvent(list, layout.begin_date + box.day, entries[box.slot], box, layout.lines);
+                ++redrawn;
+            }
+        }
+        for (const grid_box &box : layout.grid_boxes)
+        {
+            if (changed[box.slot])
+            {
+                this->drawGridBox(list, entries[box.slot], box);
+                ++redrawn;
+            }
+        }
+        return redrawn;
+    }
+}
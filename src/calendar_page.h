@@ -0,0 +1,184 @@
+#ifndef calendar_page_h
+#define calendar_page_h
+
+#include <stdint.h>
+#include <vector>
+
+#include "date.h"
+#include "datetime.h"
+#include "display_list.h"
+#include "event_order.h"
+#include "event_select.h"
+#include "layout_cache.h"
+#include "mystring.h"
+#include "range_index.h"
+#include "text_layout.h"
+#include "time_grid.h"
+#include "types.h"
+
+namespace Project
+{
+    enum status_t
+    {
+        pending,
+        in_progress,
+        completed,
+        cancelled
+    };
+
+    // Struct for storing calender event info
+    struct entry
+    {
+        string title;
+        DateTime start_time;
+        DateTime end_time;
+        Date start_date;
+        Date end_date;
+        int day;
+        status_t status;
+        int importance;
+
+        entry(const string &summary, const DateTime &start_time, const DateTime &end_time, const Date &start_date,
+              const Date &end_date, int day, status_t status, int importance);
+    };
+
+    // Where an event box goes, worked out before anything is drawn
+    struct event_box
+    {
+        unsigned slot;
+        int day;
+        int y_top;
+        int y_bottom;
+        unsigned first_line;
+        unsigned line_count;
+    };
+
+    // Where a time grid box went
+    struct grid_box
+    {
+        unsigned slot;
+        int x1;
+        int y1;
+        int x2;
+        int y2;
+    };
+
+    // What was drawn for a page: its events, with the status each was
+    // drawn with, and where their boxes are, so a box can be drawn again
+    // on its own when the status changes. hidden has the events left out
+    // of a column for want of room.
+    struct page_layout
+    {
+        Date begin_date;
+        std::vector<entry> entries;
+        std::vector<TextLine> lines;
+        std::vector<event_box> boxes;
+        std::vector<grid_box> grid_boxes;
+        std::vector<unsigned> hidden;
+    };
+
+    // Where everything goes on the page and in which fonts. On the device
+    // it comes from config.h, the defaults are those of config.h.src.
+    struct page_style
+    {
+        int width = 0;
+        int height = 0;
+        int columns = 5;
+        int column_width = 0;
+        int border_width = 3;
+        int border_top = 30;
+        int border_bottom = 3;
+        int inside_spacing_width = 4;
+        int inside_spacing_height = 4;
+        int event_spacing_width = 8;
+        int event_spacing_height = 8;
+        int header_height = 30;
+
+        // Time grid view, with an hour axis
+        bool time_grid = false;
+        int first_hour = 7;
+        int last_hour = 21;
+
+        // Clock area in the header, right of the title and above the grid
+        int clock_x = 500;
+        int clock_y = 20;
+
+        const FontMetrics *title_font = nullptr;
+        const FontMetrics *small_font = nullptr;
+    };
+
+    // The calendar as drawing operations: the header, the grid of days,
+    // the events of a page and the boxes of events whose status changed.
+    // Nothing here touches the display or the clock, times are passed in,
+    // so the device and a server rendering for thin clients draw the same
+    // page.
+    //
+    // Every draw shares the layout cache and reuses scratch memory held
+    // by the page, so one CalendarPage is only used from one thread.
+    class CalendarPage
+    {
+    public:
+        CalendarPage(const page_style &style, LayoutCache &cache, TZ_ptr tz);
+
+        CalendarPage(const CalendarPage &) = delete;
+        CalendarPage &operator=(const CalendarPage &) = delete;
+
+        const page_style &style() const { return this->page; }
+
+        // Every event, whichever days they fall on. Bumps the generation,
+        // pages drawn from older events are out of date.
+        void setEvents(std::vector<entry> &&events);
+        const std::vector<entry> &events() const { return this->all_events; }
+        uint32_t generation() const { return this->events_generation; }
+
+        void drawInfo(DisplayList &list) const;
+        void drawTime(DisplayList &list, seconds_t now) const;
+        void drawGrid(DisplayList &list, const Date &local_date) const;
+        void drawGridLines(DisplayList &list) const;
+        static void drawBorders(DisplayList &list, int bx1, int by1, int bx2, int by2, int borders);
+
+        // The events of the page of columns days from begin_date, with
+        // their status as of now. What was drawn where goes in layout.
+        void drawData(DisplayList &list, const Date &begin_date, seconds_t now, page_layout &layout);
+
+        // Draws the boxes of events on a page whose status has changed by
+        // now, and works out when the next one changes, 0 if none will.
+        // Returns how many boxes were drawn.
+        unsigned refreshStatuses(DisplayList &list, page_layout &layout, seconds_t now, seconds_t &next_change);
+
+        static status_t statusAt(const entry &event, seconds_t now);
+        static seconds_t nextStatusChange(const entry &event, seconds_t now);
+
+    protected:
+        int gridTop() const;
+        int gridBottom() const;
+        int gridY(seconds_t seconds) const;
+        void drawHourLines(DisplayList &list) const;
+        void measureEvent(const entry &event, int beginY, std::vector<TextLine> &lines, event_box &box);
+        void drawEvent(DisplayList &list, const Date &local_date, const entry &event, const event_box &box,
+                       const std::vector<TextLine> &lines) const;
+        void drawTimeGrid(DisplayList &list, page_layout &layout);
+        void drawGridBox(DisplayList &list, const entry &event, const grid_box &box);
+
+        page_style page;
+        LayoutCache &cache;
+        TZ_ptr tz;
+
+        std::vector<entry> all_events;
+        RangeIndex event_ranges;
+        uint32_t events_generation;
+
+        // Scratch, kept to reuse the memory
+        std::vector<unsigned> slots;
+        EventOrder order;
+        std::vector<select_item> items;
+        std::vector<unsigned> kept;
+        std::vector<int> hidden_count;
+        std::vector<int> less_important;
+        std::vector<seconds_t> day_starts;
+        std::vector<bool> changed;
+        TimeGrid grid;
+    };
+}
+
+#endif
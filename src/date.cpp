@@ -23,37 +23,24 @@ namespace Project
 
     Date::Date(days_t days)
     {
-        std::tuple<unsigned, unsigned, unsigned> ymd = civil_from_days(days);
-        this->year = std::get<0>(ymd);
-        this->month = std::get<1>(ymd);
-        this->day = std::get<2>(ymd);
-        this->validate();
+        this->setIndex(days);
     }
 
-    Date::Date(const string &date)
+    Date::Date(const string_ref &date)
     {
-        for (;;)
+        int year, month, day;
+        if (date.length() == 8 &&
+            date.substr(0, 4).to_digits(year) &&
+            date.substr(4, 2).to_digits(month) &&
+            date.substr(6, 2).to_digits(day))
         {
-            try
-            {
-                if (date.length() != 8)
-                {
-                    break;
-                }
-                this->year = date.substr(0, 4).as_int();
-                this->month = date.substr(4, 2).as_int();
-                this->day = date.substr(6, 2).as_int();
-                this->validate();
-                return;
-            }
-            catch (std::invalid_argument const &e)
-            {
-            }
-            catch (std::out_of_range const &e)
-            {
-            }
+            this->year = year;
+            this->month = month;
+            this->day = day;
+            this->validate();
+            return;
         }
-        throw ValueError(string("Bad date: \"") + date + "\"");
+        throw ValueError(string("Bad date: \"") + date.str() + "\"");
     }
 
     Date::Date(unsigned year, unsigned month, unsigned day)
@@ -164,9 +151,9 @@ namespace Project
 
     void Date::str(ostream &out) const
     {
-        this->year < 9999 ? out << string::fmt(fmt_04d, this->year) : out << "????";
-        this->month > 0 && this->month < 13 ? out << string::fmt(fmt_02d, this->month) : out << "??";
-        this->day > 0 && this->day < 32 ? out << string::fmt(fmt_02d, this->day) : out << "??";
+        this->year < 9999 ? out << zero_pad(this->year, 4) : out << "????";
+        this->month > 0 && this->month < 13 ? out << zero_pad(this->month, 2) : out << "??";
+        this->day > 0 && this->day < 32 ? out << zero_pad(this->day, 2) : out << "??";
     }
 
     string Date::as_str() const
@@ -190,34 +177,23 @@ namespace Project
         return (DateTime::Day)weekday;
     }
 
+    // ISO 8601 week number, [1, 53]. Days at the start or end of a year
+    // may belong to a week of the neighbouring year, see isoYear().
     unsigned Date::weekNo() const
     {
-        auto getWeekNo = [](unsigned weekdayFirst, unsigned yearDayIndex)
-        {
-            if (weekdayFirst <= 4)
-                return (weekdayFirst + yearDayIndex - 1) / 7 + 1;
-            else
-                return (weekdayFirst + yearDayIndex - 1) / 7;
-        };
-
-        unsigned days = days_from_civil(this->year, this->month, this->day);
-        unsigned daysFirst = days_from_civil(this->year, 1, 1);
-        unsigned weekdayFirst = (unsigned)this->getWeekDay(daysFirst);
-        unsigned yearDayIndex = days - daysFirst;
-
-        unsigned weekNo = getWeekNo(weekdayFirst, yearDayIndex);
-        if (weekNo != 0)
-            return weekNo;
-
-        if (is_leap(this->year - 1))
-            daysFirst -= 366;
-        else
-            daysFirst -= 365;
-
-        weekdayFirst = (unsigned)this->getWeekDay(daysFirst);
-        yearDayIndex = days - daysFirst;
+        days_t days = this->index();
+        unsigned year = this->isoYear();
+        return (days - iso_week_one(year)) / 7 + 1;
+    }
 
-        return getWeekNo(weekdayFirst, yearDayIndex);
+    unsigned Date::isoYear() const
+    {
+        days_t days = this->index();
+        if (days >= iso_week_one(this->year + 1))
+            return this->year + 1;
+        if (days < iso_week_one(this->year))
+            return this->year - 1;
+        return this->year;
     }
 
     unsigned Date::dayOfYear() const
@@ -239,99 +215,104 @@ namespace Project
         return 365;
     }
 
-    void Date::setWeekNo(unsigned n)
+    void Date::setIndex(days_t index)
     {
-        auto yearDayIndex = [](unsigned weekdayFirst, unsigned weekNo)
-        {
-            if (weekdayFirst <= 4)
-                return ((int)weekNo - 1) * 7 - (int)weekdayFirst + 1;
-            else
-                return (int)weekNo * 7 - (int)weekdayFirst + 1;
-        };
+        std::tuple<unsigned, unsigned, unsigned> ymd = civil_from_days(index);
+        this->year = std::get<0>(ymd);
+        this->month = std::get<1>(ymd);
+        this->day = std::get<2>(ymd);
+        this->validate();
+    }
 
-        unsigned daysFirst = days_from_civil(this->year, 1, 1);
-        unsigned weekdayFirst = (unsigned)this->getWeekDay(daysFirst);
+    void Date::addDays(int n)
+    {
+        this->setIndex(this->index() + n);
+    }
 
-        this->day = 1;
-        this->month = 1;
-        int index = yearDayIndex(weekdayFirst, n);
-        if (index > 0)
-            this->incDay(index);
+    void Date::addWeeks(int n)
+    {
+        this->addDays(7 * n);
     }
 
-    void Date::decDay(unsigned n)
+    void Date::addMonths(int n, MonthEnd policy)
     {
-        this->day--;
-        while (n > this->day)
+        int months = (int)this->year * 12 + (int)this->month - 1 + n;
+        if (months < 0)
+        {
+            throw ValueError("Month arithmetic before year 0");
+        }
+        unsigned year = months / 12;
+        unsigned month = months % 12 + 1;
+        unsigned last_day = last_day_of_month(year, month);
+
+        if (this->day <= last_day)
+        {
+            this->year = year;
+            this->month = month;
+            this->validate();
+        }
+        else if (policy == MonthEnd::CLAMP)
         {
-            n -= this->day;
-            this->decMonth(1);
-            this->day = last_day_of_month(this->year, this->month);
+            this->year = year;
+            this->month = month;
+            this->day = last_day;
+            this->validate();
         }
-        this->day -= n;
-        this->day++;
+        else
+        {
+            this->setIndex(days_from_civil(year, month, 1) + this->day - 1);
+        }
+    }
+
+    void Date::addYears(int n, MonthEnd policy)
+    {
+        this->addMonths(12 * n, policy);
+    }
+
+    // Sets the date to the Monday of ISO week n of the current year.
+    void Date::setWeekNo(unsigned n)
+    {
+        *this = Date::fromIsoWeek(this->year, n, DateTime::Day::MON);
+    }
+
+    Date Date::fromIsoWeek(unsigned isoYear, unsigned week, DateTime::Day day)
+    {
+        return Date(iso_week_one(isoYear) + (week - 1) * 7 + (unsigned)day - 1);
+    }
+
+    void Date::decDay(unsigned n)
+    {
+        this->addDays(-(int)n);
     }
 
     void Date::incDay(unsigned n)
     {
-        this->day--;
-        {
-            this->day += n;
-            while (true)
-            {
-                if (this->day < 27)
-                {
-                    break;
-                }
-                unsigned last_day = last_day_of_month(this->year, this->month);
-                if (this->day < last_day)
-                {
-                    break;
-                }
-                this->day -= last_day;
-                this->incMonth(1);
-            }
-        }
-        this->day++;
+        this->addDays(n);
     }
 
     void Date::incWeek(unsigned n, DateTime::Day wkst)
     {
+        // Move to the start of the n'th week after this one, counting this
+        // week as the first if today is the week start.
         auto dayOfWeek = this->getDayOfWeek();
-        this->incDay(DateTime::daysUntil(dayOfWeek, wkst));
-        this->incDay(7 * (n - (dayOfWeek == wkst ? 0 : 1)));
+        int days = DateTime::daysUntil(dayOfWeek, wkst);
+        days += 7 * ((int)n - (dayOfWeek == wkst ? 0 : 1));
+        this->addDays(days);
     }
 
     void Date::decMonth(unsigned n)
     {
-        this->month--;
-        while (n > this->month)
-        {
-            n -= month;
-            this->month = 11;
-            this->year--;
-        }
-        this->month -= n;
-        this->month++;
+        this->addMonths(-(int)n);
     }
 
     void Date::incMonth(unsigned n)
     {
-        this->month--;
-        {
-            this->month += n;
-            if (this->month > 11)
-            {
-                this->incYear(this->month / 12);
-            }
-            this->month %= 12;
-        }
-        this->month++;
+        this->addMonths(n);
     }
 
     void Date::incYear(unsigned n)
     {
-        this->year += n;
+        this->addYears(n);
     }
 
     string Date::format(string format) const
@@ -14,7 +14,7 @@ namespace Project
     public:
         Date();
         Date(days_t index);
-        Date(const string &date);
+        Date(const string_ref &date);
         Date(unsigned year, unsigned month, unsigned day);
         Date(const DateTime &datetime);
 
@@ -27,12 +27,27 @@ namespace Project
 
         bool valid() const;
 
+        // What to do when a month or year step lands past the end of the
+        // month, e.g. Jan 31 + 1 month: CLAMP gives Feb 28/29, ROLL_OVER
+        // carries the extra days into the next month (Mar 2/3).
+        enum class MonthEnd
+        {
+            CLAMP,
+            ROLL_OVER
+        };
+
         DateTime::Day getDayOfWeek() const;
         unsigned weekNo() const;
+        unsigned isoYear() const;
         unsigned dayOfYear() const;
         unsigned daysInMonth() const;
         unsigned daysInYear() const;
 
+        void addDays(int n);
+        void addWeeks(int n);
+        void addMonths(int n, MonthEnd policy = MonthEnd::CLAMP);
+        void addYears(int n, MonthEnd policy = MonthEnd::CLAMP);
+
         void incYear(unsigned n);
         void incMonth(unsigned n);
         void incWeek(unsigned n, DateTime::Day wkst);
@@ -42,6 +57,7 @@ namespace Project
         void decMonth(unsigned n);
 
         void setWeekNo(unsigned n);
+        static Date fromIsoWeek(unsigned isoYear, unsigned week, DateTime::Day day);
 
         Date(const Date &) = default;
         Date &operator=(const Date &ds);
@@ -60,9 +76,12 @@ namespace Project
 
         string format(string format) const;
 
-    protected:
+        // Days since the epoch, e.g. to key caches by date
         days_t index() const;
+
+    protected:
         void validate() const;
+        void setIndex(days_t index);
         DateTime::Day getWeekDay(unsigned days) const;
     };
 }
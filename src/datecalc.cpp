@@ -70,6 +70,16 @@ namespace Project
         return (z + 4) % 7;
     }
 
+    // Returns the day number of the Monday starting ISO week 1 of year y,
+    // i.e. the Monday of the week containing January 4th.
+    // This may be before 1970-01-01, hence signed.
+    int iso_week_one(unsigned y) noexcept
+    {
+        int jan4 = days_from_civil(y, 1, 4);
+        int weekday = (weekday_from_days(jan4) + 6) % 7; // [0, 6] -> [Mon, Sun]
+        return jan4 - weekday;
+    }
+
     dhms_t to_dhms(seconds_t seconds)
     {
         unsigned hour, minute, second;
@@ -14,6 +14,7 @@ namespace Project
     unsigned last_day_of_month_leap_year(unsigned m) noexcept;
     unsigned last_day_of_month(unsigned y, unsigned m) noexcept;
     unsigned weekday_from_days(unsigned z) noexcept;
+    int iso_week_one(unsigned y) noexcept;
     unsigned weekday_difference(unsigned x, unsigned y) noexcept;
     unsigned next_weekday(unsigned wd) noexcept;
     unsigned prev_weekday(unsigned wd) noexcept;
@@ -146,13 +146,13 @@ namespace Project
     {
         auto ymdhms = this->epoch_time.ymdhms(this->tz);
 
-        out << string::fmt(fmt_04d, std::get<0>(ymdhms));
-        out << string::fmt(fmt_02d, std::get<1>(ymdhms));
-        out << string::fmt(fmt_02d, std::get<2>(ymdhms));
+        out << zero_pad(std::get<0>(ymdhms), 4);
+        out << zero_pad(std::get<1>(ymdhms), 2);
+        out << zero_pad(std::get<2>(ymdhms), 2);
         out << "T";
-        out << string::fmt(fmt_02d, std::get<3>(ymdhms));
-        out << string::fmt(fmt_02d, std::get<4>(ymdhms));
-        out << string::fmt(fmt_02d, std::get<5>(ymdhms));
+        out << zero_pad(std::get<3>(ymdhms), 2);
+        out << zero_pad(std::get<4>(ymdhms), 2);
+        out << zero_pad(std::get<5>(ymdhms), 2);
 
         this->tz->str(out);
     }
@@ -167,7 +167,8 @@ namespace Project
     string DateTime::format(string format) const
     {
         const time_t secs = this->tz->fromUTC(this->epoch_time.epochSeconds);
-        const struct tm time = *gmtime(&secs);
+        struct tm time;
+        gmtime_r(&secs, &time);
         char buffer[64];
         strftime(buffer, 64, format.c_str(), &time);
         string result = buffer;
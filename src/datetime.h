@@ -1,9 +1,12 @@
 #ifndef DATETIME_H
 #define DATETIME_H
 
+#include <functional>
+
 #include "datecalc.h"
 #include "dateperiod.h"
 #include "epochtime.h"
+#include "hash.h"
 #include "mystring.h"
 #include "types.h"
 
@@ -75,16 +78,16 @@ namespace Project
     };
 }
 
-// namespace std
-// {
-//     template <>
-//     struct hash<DateTime>
-//     {
-//         size_t operator()(const DateTime &k) const
-//         {
-//             return k.epoch_time.epochSeconds;
-//         }
-//     };
-// }
+namespace std
+{
+    template <>
+    struct hash<Project::DateTime>
+    {
+        size_t operator()(const Project::DateTime &k) const
+        {
+            return Project::hash_mix(k.epoch_time.epochSeconds);
+        }
+    };
+}
 
 #endif
\ No newline at end of file
@@ -0,0 +1,118 @@
+#include "deadline_queue.h"
+
+namespace Project
+{
+    const size_t DeadlineQueue::NONE;
+
+    void DeadlineQueue::schedule(unsigned id, seconds_t when)
+    {
+        size_t i = this->position[id];
+        if (i == NONE)
+        {
+            i = this->heap.size();
+            this->heap.push_back(deadline{when, id});
+            this->position[id] = i;
+            this->sift_up(i);
+            return;
+        }
+
+        seconds_t was = this->heap[i].when;
+        this->heap[i].when = when;
+        if (when < was)
+        {
+            this->sift_up(i);
+        }
+        else
+        {
+            this->sift_down(i);
+        }
+    }
+
+    void DeadlineQueue::cancel(unsigned id)
+    {
+        if (this->position[id] != NONE)
+        {
+            this->remove(this->position[id]);
+        }
+    }
+
+    bool DeadlineQueue::pop(seconds_t now, unsigned &id)
+    {
+        if (this->heap.empty() || this->heap[0].when > now)
+        {
+            return false;
+        }
+        id = this->heap[0].id;
+        this->remove(0);
+        return true;
+    }
+
+    void DeadlineQueue::remove(size_t i)
+    {
+        this->position[this->heap[i].id] = NONE;
+
+        // The last one fills the gap, then goes whichever way it has to
+        deadline last = this->heap.back();
+        this->heap.pop_back();
+        if (i == this->heap.size())
+        {
+            return;
+        }
+        this->place(i, last);
+        if (i > 0 && last.when < this->heap[(i - 1) / 2].when)
+        {
+            this->sift_up(i);
+        }
+        else
+        {
+            this->sift_down(i);
+        }
+    }
+
+    void DeadlineQueue::place(size_t i, const deadline &d)
+    {
+        this->heap[i] = d;
+        this->position[d.id] = i;
+    }
+
+    void DeadlineQueue::sift_up(size_t i)
+    {
+        deadline d = this->heap[i];
+        while (i > 0)
+        {
+            size_t parent = (i - 1) / 2;
+            if (!(d.when < this->heap[parent].when))
+            {
+                break;
+            }
+            this->place(i, this->heap[parent]);
+            i = parent;
+        }
+        this->place(i, d);
+    }
+
+    void DeadlineQueue::sift_down(size_t i)
+    {
+        deadline d = this->heap[i];
+        size_t size = this->heap.size();
+        for (;;)
+        {
+            size_t child = 2 * i + 1;
+            if (child >= size)
+            {
+                break;
+            }
+            if (child + 1 < size && this->heap[child + 1].when < this->heap[child].when)
+            {
+                ++child;
+            }
+            if (!(this->heap[child].when < d.when))
+            {
+                break;
+            }
+            this->place(i, this->heap[child]);
+            i = child;
+        }
+        this->place(i, d);
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef deadline_queue_h
+#define deadline_queue_h
+
+#include <vector>
+
+#include "types.h"
+
+namespace Project
+{
+    // The next time each of a fixed set of things has to happen, e.g.
+    // the clock ticking over or an event starting, earliest first.
+    //
+    // A binary min-heap that also knows where each id sits in it, so an
+    // id has at most one deadline and moving it is O(log n).
+    class DeadlineQueue
+    {
+    public:
+        explicit DeadlineQueue(unsigned ids) : position(ids, NONE) {}
+
+        // Sets or moves the deadline for id
+        void schedule(unsigned id, seconds_t when);
+        void cancel(unsigned id);
+
+        bool scheduled(unsigned id) const { return this->position[id] != NONE; }
+        bool empty() const { return this->heap.empty(); }
+
+        // The earliest deadline, only meaningful when not empty()
+        seconds_t next() const { return this->heap[0].when; }
+
+        // Takes the earliest deadline off if it's due by now. Returns
+        // whether there was one, and its id.
+        bool pop(seconds_t now, unsigned &id);
+
+    protected:
+        static const size_t NONE = (size_t)-1;
+
+        struct deadline
+        {
+            seconds_t when;
+            unsigned id;
+        };
+
+        void remove(size_t i);
+        void place(size_t i, const deadline &d);
+        void sift_up(size_t i);
+        void sift_down(size_t i);
+
+        std::vector<deadline> heap;
+        std::vector<size_t> position;
+    };
+}
+
+#endif
@@ -0,0 +1,212 @@
+#include "display_list.h"
+
+#include "glyph_atlas.h"
+
+namespace Project
+{
+    void DisplayList::clear()
+    {
+        this->ops.clear();
+        this->text_pool.clear();
+    }
+
+    void DisplayList::fillRect(int x, int y, int w, int h, uint8_t color)
+    {
+        if (w <= 0 || h <= 0)
+        {
+            return;
+        }
+        Op op = {};
+        op.type = OpType::FILL_RECT;
+        op.color = color;
+        op.rect = Rect{x, y, w, h};
+        op.bounds = op.rect;
+        this->ops.push_back(op);
+    }
+
+    void DisplayList::fillRoundRect(int x, int y, int w, int h, int radius, uint8_t color)
+    {
+        if (w <= 0 || h <= 0)
+        {
+            return;
+        }
+        Op op = {};
+        op.type = OpType::FILL_ROUND_RECT;
+        op.color = color;
+        op.radius = radius;
+        op.rect = Rect{x, y, w, h};
+        op.bounds = op.rect;
+        this->ops.push_back(op);
+    }
+
+    // Lines of more than one pixel grow down / right, like drawThickLine
+    void DisplayList::hline(int x, int y, int w, uint8_t color, int thickness)
+    {
+        this->fillRect(x, y - (thickness - 1) / 2, w, thickness, color);
+    }
+
+    void DisplayList::vline(int x, int y, int h, uint8_t color, int thickness)
+    {
+        this->fillRect(x - (thickness - 1) / 2, y, thickness, h, color);
+    }
+
+    void DisplayList::rect(int x, int y, int w, int h, uint8_t color)
+    {
+        if (w <= 0 || h <= 0)
+        {
+            return;
+        }
+        this->fillRect(x, y, w, 1, color);
+        this->fillRect(x, y + h - 1, w, 1, color);
+        this->fillRect(x, y + 1, 1, h - 2, color);
+        this->fillRect(x + w - 1, y + 1, 1, h - 2, color);
+    }
+
+    int DisplayList::text(const FontMetrics &font, int x, int y, const string_ref &text, uint8_t color)
+    {
+        // Work out the ink bounds now so render() can skip text outside
+        // its band without looking at the glyphs
+        int min_x = INT16_MAX, min_y = INT16_MAX, max_x = INT16_MIN, max_y = INT16_MIN;
+        int pen = x;
+        size_t pos = 0;
+        while (pos < text.length())
+        {
+            const FontMetrics::glyph_metrics *glyph = font.glyph(next_codepoint(text, pos));
+            if (glyph == nullptr)
+            {
+                continue;
+            }
+            if (glyph->width > 0 && glyph->height > 0)
+            {
+                int x1 = pen + glyph->offset, y1 = y + glyph->y_offset;
+                min_x = x1 < min_x ? x1 : min_x;
+                min_y = y1 < min_y ? y1 : min_y;
+                max_x = x1 + glyph->width > max_x ? x1 + glyph->width : max_x;
+                max_y = y1 + glyph->height > max_y ? y1 + glyph->height : max_y;
+            }
+            pen += glyph->advance;
+        }
+
+        if (max_x > min_x)
+        {
+            Op op = {};
+            op.type = OpType::TEXT;
+            op.color = color;
+            op.rect = Rect{x, y, 0, 0};
+            op.bounds = Rect{min_x, min_y, max_x - min_x, max_y - min_y};
+            op.font = &font;
+            op.text_offset = this->text_pool.size();
+            op.text_length = text.length();
+            this->text_pool.insert(this->text_pool.end(), text.data(), text.data() + text.length());
+            this->ops.push_back(op);
+        }
+        return pen;
+    }
+
+    // Everything is mapped to the panel with the rotation fixed at
+    // compile time, one copy of the loop per rotation
+    void DisplayList::render(Raster &raster) const
+    {
+        switch (raster.getRotation())
+        {
+        case 1:
+            this->renderRotated<1>(raster);
+            break;
+        case 2:
+            this->renderRotated<2>(raster);
+            break;
+        case 3:
+            this->renderRotated<3>(raster);
+            break;
+        default:
+            this->renderRotated<0>(raster);
+            break;
+        }
+    }
+
+    template <int R>
+    void DisplayList::renderRotated(Raster &raster) const
+    {
+        const int pw = raster.panelWidth(), ph = raster.panelHeight();
+        auto fill = [&raster, pw, ph](int x, int y, int w, int h, uint8_t color)
+        {
+            if (w > 0 && h > 0)
+            {
+                Rect panel = Rotation<R>::toPanel(Rect{x, y, w, h}, pw, ph);
+                raster.fillPanel(panel.x, panel.y, panel.w, panel.h, color);
+            }
+        };
+
+        for (const Op &op : this->ops)
+        {
+            if (raster.panelClipped(Rotation<R>::toPanel(op.bounds, pw, ph)))
+            {
+                continue;
+            }
+            switch (op.type)
+            {
+            case OpType::FILL_RECT:
+                fill(op.rect.x, op.rect.y, op.rect.w, op.rect.h, op.color);
+                break;
+            case OpType::FILL_ROUND_RECT:
+                round_rect_spans(op.rect.x, op.rect.y, op.rect.w, op.rect.h, op.radius,
+                                 [&fill, &op](int x, int y, int w, int h)
+                                 { fill(x, y, w, h, op.color); });
+                break;
+            case OpType::TEXT:
+            {
+                const GlyphAtlas &atlas = GlyphAtlas::get(*op.font, R, raster.getFormat());
+                const string_ref text(&this->text_pool[op.text_offset], op.text_length);
+                int pen = op.rect.x;
+                size_t pos = 0;
+                while (pos < text.length())
+                {
+                    const FontMetrics::glyph_metrics *glyph = op.font->glyph(next_codepoint(text, pos));
+                    if (glyph == nullptr)
+                    {
+                        continue;
+                    }
+                    Rect box{pen + glyph->offset, op.rect.y + glyph->y_offset, glyph->width, glyph->height};
+                    atlas.drawPanel(raster, Rotation<R>::toPanel(box, pw, ph), glyph, op.color);
+                    pen += glyph->advance;
+                }
+                break;
+            }
+            }
+        }
+    }
+
+    bool DisplayList::grayscale() const
+    {
+        for (const Op &op : this->ops)
+        {
+            if (op.color != 0 && op.color != 7)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void DisplayList::prepare(const Raster &target) const
+    {
+        for (const Op &op : this->ops)
+        {
+            if (op.type != OpType::TEXT)
+            {
+                continue;
+            }
+            GlyphAtlas &atlas = GlyphAtlas::get(*op.font, target.getRotation(), target.getFormat());
+            const string_ref text(&this->text_pool[op.text_offset], op.text_length);
+            size_t pos = 0;
+            while (pos < text.length())
+            {
+                const FontMetrics::glyph_metrics *glyph = op.font->glyph(next_codepoint(text, pos));
+                if (glyph != nullptr)
+                {
+                    atlas.add(glyph);
+                }
+            }
+        }
+    }
+}
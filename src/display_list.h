@@ -0,0 +1,74 @@
+#ifndef display_list_h
+#define display_list_h
+
+#include <stdint.h>
+#include <vector>
+
+#include "mystring.h"
+#include "raster.h"
+#include "rect.h"
+#include "text_layout.h"
+
+namespace Project
+{
+    // A frame recorded as drawing operations, in the same rotated
+    // coordinates as Adafruit GFX. Recording is cheap and has no effect
+    // on the framebuffer; render() can then be run for any part of the
+    // panel, from any thread.
+    class DisplayList
+    {
+    public:
+        enum class OpType : uint8_t
+        {
+            FILL_RECT,
+            FILL_ROUND_RECT,
+            TEXT
+        };
+
+        struct Op
+        {
+            OpType type;
+            uint8_t color;
+            int16_t radius;
+            Rect rect;
+            Rect bounds;
+            const FontMetrics *font;
+            uint32_t text_offset;
+            uint16_t text_length;
+        };
+
+        void clear();
+
+        void fillRect(int x, int y, int w, int h, uint8_t color);
+        void fillRoundRect(int x, int y, int w, int h, int radius, uint8_t color);
+        void hline(int x, int y, int w, uint8_t color, int thickness = 1);
+        void vline(int x, int y, int h, uint8_t color, int thickness = 1);
+        void rect(int x, int y, int w, int h, uint8_t color);
+
+        // Text with its baseline starting at x, y. Returns the x where
+        // the next character would go, like the GFX cursor.
+        int text(const FontMetrics &font, int x, int y, const string_ref &text, uint8_t color);
+
+        size_t size() const { return this->ops.size(); }
+        const Op &operator[](size_t i) const { return this->ops[i]; }
+
+        // True if anything is drawn in a shade between black and white
+        bool grayscale() const;
+
+        // Adds the glyphs render() will need for target to the glyph
+        // atlases, so that rendering itself only reads shared state
+        void prepare(const Raster &target) const;
+
+        // Draws every operation that reaches the raster's clip rows
+        void render(Raster &raster) const;
+
+    protected:
+        template <int R>
+        void renderRotated(Raster &raster) const;
+
+        std::vector<Op> ops;
+        std::vector<char> text_pool;
+    };
+}
+
+#endif
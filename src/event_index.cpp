@@ -0,0 +1,156 @@
+#include "event_index.h"
+
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef BOARD_HAS_PSRAM
+#include <esp32-hal-psram.h>
+#endif
+
+namespace Project
+{
+    static void *arena_alloc(size_t size)
+    {
+#ifdef BOARD_HAS_PSRAM
+        void *ptr = ps_malloc(size);
+#else
+        void *ptr = malloc(size);
+#endif
+        if (ptr == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+        return ptr;
+    }
+
+    EventIndex::EventIndex(size_t max_events, size_t average_id_length)
+        : max_events(max_events), count(0), ids_used(0)
+    {
+        // Keep the load factor at or below 50%
+        size_t buckets = 8;
+        while (buckets < max_events * 2)
+        {
+            buckets *= 2;
+        }
+        this->mask = buckets - 1;
+        this->ids_capacity = max_events * average_id_length;
+
+        this->arena = (uint8_t *)arena_alloc(buckets * sizeof(bucket) + this->ids_capacity);
+        this->buckets = (bucket *)this->arena;
+        this->ids = (char *)(this->arena + buckets * sizeof(bucket));
+        this->clear();
+    }
+
+    EventIndex::~EventIndex()
+    {
+        free(this->arena);
+    }
+
+    void EventIndex::clear()
+    {
+        for (size_t i = 0; i <= this->mask; ++i)
+        {
+            this->buckets[i].slot = NONE;
+        }
+        this->count = 0;
+        this->ids_used = 0;
+    }
+
+    string_ref EventIndex::id_of(const bucket &b) const
+    {
+        return string_ref(this->ids + b.id_offset, b.id_length);
+    }
+
+    // Returns the bucket holding id, or the empty bucket where it would go.
+    size_t EventIndex::probe(const string_ref &id, uint32_t hash) const
+    {
+        size_t i = hash & this->mask;
+        while (this->used(this->buckets[i]))
+        {
+            const bucket &b = this->buckets[i];
+            if (b.hash == hash && this->id_of(b) == id)
+            {
+                break;
+            }
+            i = (i + 1) & this->mask;
+        }
+        return i;
+    }
+
+    unsigned EventIndex::insert(const string_ref &id, unsigned slot)
+    {
+        uint32_t hash = hash_bytes(id.data(), id.length());
+        size_t i = this->probe(id, hash);
+        bucket &b = this->buckets[i];
+        if (this->used(b))
+        {
+            return b.slot;
+        }
+
+        if (slot == NONE || this->count >= this->max_events || this->ids_used + id.length() > this->ids_capacity)
+        {
+            return NONE;
+        }
+
+        memcpy(this->ids + this->ids_used, id.data(), id.length());
+        b.hash = hash;
+        b.slot = slot;
+        b.id_offset = this->ids_used;
+        b.id_length = id.length();
+        this->ids_used += id.length();
+        ++this->count;
+        return slot;
+    }
+
+    bool EventIndex::assign(const string_ref &id, unsigned slot)
+    {
+        uint32_t hash = hash_bytes(id.data(), id.length());
+        size_t i = this->probe(id, hash);
+        if (this->used(this->buckets[i]))
+        {
+            this->buckets[i].slot = slot;
+            return true;
+        }
+        return this->insert(id, slot) != NONE;
+    }
+
+    unsigned EventIndex::find(const string_ref &id) const
+    {
+        uint32_t hash = hash_bytes(id.data(), id.length());
+        return this->buckets[this->probe(id, hash)].slot;
+    }
+
+    // Backward shift deletion, so no tombstones are needed. The id bytes
+    // are not reclaimed until clear().
+    bool EventIndex::erase(const string_ref &id)
+    {
+        uint32_t hash = hash_bytes(id.data(), id.length());
+        size_t i = this->probe(id, hash);
+        if (!this->used(this->buckets[i]))
+        {
+            return false;
+        }
+
+        size_t j = i;
+        while (true)
+        {
+            j = (j + 1) & this->mask;
+            if (!this->used(this->buckets[j]))
+            {
+                break;
+            }
+            // Move j back to the hole at i unless its home bucket lies
+            // cyclically in (i, j].
+            size_t home = this->buckets[j].hash & this->mask;
+            if (((j - home) & this->mask) >= ((j - i) & this->mask))
+            {
+                this->buckets[i] = this->buckets[j];
+                i = j;
+            }
+        }
+        this->buckets[i].slot = NONE;
+        --this->count;
+        return true;
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef event_index_h
+#define event_index_h
+
+#include <stdint.h>
+
+#include "mystring.h"
+
+namespace Project
+{
+    // Maps event ids to event slots.
+    //
+    // Open addressing with linear probing. The table and the id bytes
+    // live in one arena allocated up front, so lookups and inserts never
+    // allocate and clear() is O(buckets).
+    class EventIndex
+    {
+    public:
+        static const unsigned NONE = (unsigned)-1;
+
+        EventIndex(size_t max_events, size_t average_id_length = 48);
+        ~EventIndex();
+
+        EventIndex(const EventIndex &) = delete;
+        EventIndex &operator=(const EventIndex &) = delete;
+
+        void clear();
+
+        // Stores slot for id and returns it. If id is already present the
+        // existing slot is returned instead and nothing changes. Returns
+        // NONE if the arena is full.
+        unsigned insert(const string_ref &id, unsigned slot);
+
+        // Stores slot for id, replacing any existing entry.
+        bool assign(const string_ref &id, unsigned slot);
+
+        unsigned find(const string_ref &id) const;
+        bool erase(const string_ref &id);
+
+        size_t size() const { return this->count; }
+
+    protected:
+        struct bucket
+        {
+            uint32_t hash;
+            uint32_t slot;
+            uint32_t id_offset;
+            uint32_t id_length;
+        };
+
+        bool used(const bucket &b) const { return b.slot != NONE; }
+        size_t probe(const string_ref &id, uint32_t hash) const;
+        string_ref id_of(const bucket &b) const;
+
+        uint8_t *arena;
+        bucket *buckets;
+        char *ids;
+        size_t mask;
+        size_t max_events;
+        size_t count;
+        size_t ids_capacity;
+        size_t ids_used;
+    };
+}
+
+#endif
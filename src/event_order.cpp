@@ -0,0 +1,150 @@
+#include "event_order.h"
+
+#include "error.h"
+
+namespace Project
+{
+    static const unsigned DAY_SHIFT = 56;
+    static const unsigned START_SHIFT = 16;
+    static const sort_key_t START_MASK = (1ULL << 40) - 1;
+    static const seconds_t START_BIAS = 1LL << 39;
+
+    sort_key_t make_sort_key(unsigned day, seconds_t start_offset, unsigned tie_breaker)
+    {
+        if (tie_breaker > MAX_TIE_BREAKER)
+        {
+            throw ValueError("Sort tie breaker out of range");
+        }
+
+        // Events that started before the window have a negative offset,
+        // the bias keeps them ordered first.
+        seconds_t start = start_offset + START_BIAS;
+        if (start < 0)
+        {
+            start = 0;
+        }
+        else if (start > (seconds_t)START_MASK)
+        {
+            start = START_MASK;
+        }
+
+        return ((sort_key_t)(day & 0xff) << DAY_SHIFT) |
+               ((sort_key_t)start << START_SHIFT) |
+               (sort_key_t)tie_breaker;
+    }
+
+    unsigned sort_key_day(sort_key_t key)
+    {
+        return key >> DAY_SHIFT;
+    }
+
+    void EventOrder::clear()
+    {
+        this->items.clear();
+    }
+
+    void EventOrder::reserve(size_t n)
+    {
+        this->items.reserve(n);
+        this->scratch.reserve(n);
+    }
+
+    void EventOrder::add(sort_key_t key, unsigned slot)
+    {
+        this->items.push_back(item{key, slot});
+    }
+
+    // Stable LSD radix sort, one byte per pass. Bytes that are the same
+    // in every key (the top of the start time, usually most of the tie
+    // breaker) are skipped, so a typical week takes 3 or 4 passes.
+    void EventOrder::sort()
+    {
+        size_t n = this->items.size();
+        if (n < 2)
+        {
+            return;
+        }
+        this->scratch.resize(n);
+
+        item *src = this->items.data();
+        item *dst = this->scratch.data();
+
+        for (unsigned shift = 0; shift < 64; shift += 8)
+        {
+            size_t count[256] = {0};
+            for (size_t i = 0; i < n; ++i)
+            {
+                ++count[(src[i].key >> shift) & 0xff];
+            }
+            if (count[(src[0].key >> shift) & 0xff] == n)
+            {
+                continue;
+            }
+
+            size_t offset = 0;
+            for (unsigned b = 0; b < 256; ++b)
+            {
+                size_t c = count[b];
+                count[b] = offset;
+                offset += c;
+            }
+            for (size_t i = 0; i < n; ++i)
+            {
+                dst[count[(src[i].key >> shift) & 0xff]++] = src[i];
+            }
+
+            item *tmp = src;
+            src = dst;
+            dst = tmp;
+        }
+
+        if (src != this->items.data())
+        {
+            this->items.swap(this->scratch);
+        }
+    }
+
+    size_t EventOrder::lower_bound(sort_key_t key) const
+    {
+        size_t first = 0, last = this->items.size();
+        while (first < last)
+        {
+            size_t middle = first + (last - first) / 2;
+            if (this->items[middle].key < key)
+            {
+                first = middle + 1;
+            }
+            else
+            {
+                last = middle;
+            }
+        }
+        return first;
+    }
+
+    void EventOrder::insert(sort_key_t key, unsigned slot)
+    {
+        // Equal keys go after existing ones, to stay stable.
+        size_t pos = key == (sort_key_t)-1 ? this->items.size() : this->lower_bound(key + 1);
+        this->items.insert(this->items.begin() + pos, item{key, slot});
+    }
+
+    bool EventOrder::remove(unsigned slot)
+    {
+        for (auto it = this->items.begin(); it != this->items.end(); ++it)
+        {
+            if (it->slot == slot)
+            {
+                this->items.erase(it);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void EventOrder::column(unsigned day, size_t &first, size_t &last) const
+    {
+        first = this->lower_bound((sort_key_t)day << DAY_SHIFT);
+        last = day >= 0xff ? this->items.size() : this->lower_bound((sort_key_t)(day + 1) << DAY_SHIFT);
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef event_order_h
+#define event_order_h
+
+#include <stdint.h>
+#include <vector>
+
+#include "types.h"
+
+namespace Project
+{
+    // Events are ordered on a single packed 64 bit key:
+    //
+    //   bits 56-63  day column
+    //   bits 16-55  start time, seconds relative to the window start (biased)
+    //   bits  0-15  tie breaker, normally the position in the payload
+    //
+    // Comparing keys as plain integers therefore orders by column, then
+    // start time, then payload order.
+    //
+    // The tie breaker only has 16 bits, so only the first 65536 items of
+    // a payload can be told apart. Larger ones throw rather than having
+    // equal keys quietly put out of payload order.
+    using sort_key_t = uint64_t;
+
+    const unsigned MAX_TIE_BREAKER = 0xffff;
+
+    sort_key_t make_sort_key(unsigned day, seconds_t start_offset, unsigned tie_breaker);
+    unsigned sort_key_day(sort_key_t key);
+
+    class EventOrder
+    {
+    public:
+        struct item
+        {
+            sort_key_t key;
+            unsigned slot;
+        };
+
+        void clear();
+        void reserve(size_t n);
+
+        // Bulk load: add() everything, then sort() once.
+        void add(sort_key_t key, unsigned slot);
+        void sort();
+
+        // Incremental updates, keep the order sorted.
+        void insert(sort_key_t key, unsigned slot);
+        bool remove(unsigned slot);
+
+        size_t size() const { return this->items.size(); }
+        const item &operator[](size_t i) const { return this->items[i]; }
+        std::vector<item>::const_iterator begin() const { return this->items.begin(); }
+        std::vector<item>::const_iterator end() const { return this->items.end(); }
+
+        // Index range [first, last) of the items in a day column.
+        void column(unsigned day, size_t &first, size_t &last) const;
+
+    protected:
+        size_t lower_bound(sort_key_t key) const;
+
+        std::vector<item> items;
+        std::vector<item> scratch;
+    };
+}
+
+#endif
@@ -0,0 +1,90 @@
+#include "event_select.h"
+
+#include <algorithm>
+
+namespace Project
+{
+    void select_important(const std::vector<select_item> &items, int room, std::vector<unsigned> &kept)
+    {
+        kept.clear();
+
+        // Whether item a ranks above item b
+        auto better = [&items](unsigned a, unsigned b)
+        {
+            if (items[a].importance != items[b].importance)
+            {
+                return items[a].importance > items[b].importance;
+            }
+            return a < b;
+        };
+
+        std::vector<unsigned> candidates(items.size());
+        for (unsigned i = 0; i < items.size(); ++i)
+        {
+            candidates[i] = i;
+        }
+
+        std::vector<unsigned> heap, rest;
+        while (!candidates.empty())
+        {
+            int smallest = room + 1;
+            for (unsigned i : candidates)
+            {
+                smallest = std::min(smallest, std::max(items[i].height, 1));
+            }
+            size_t k = std::min(candidates.size(), (size_t)(room / smallest));
+            if (k == 0)
+            {
+                break;
+            }
+
+            // The K best candidates, the worst of them on top
+            heap.clear();
+            rest.clear();
+            for (unsigned i : candidates)
+            {
+                if (heap.size() < k)
+                {
+                    heap.push_back(i);
+                    std::push_heap(heap.begin(), heap.end(), better);
+                }
+                else if (better(i, heap.front()))
+                {
+                    std::pop_heap(heap.begin(), heap.end(), better);
+                    rest.push_back(heap.back());
+                    heap.back() = i;
+                    std::push_heap(heap.begin(), heap.end(), better);
+                }
+                else
+                {
+                    rest.push_back(i);
+                }
+            }
+
+            // Best first, each one that still fits is kept
+            std::sort_heap(heap.begin(), heap.end(), better);
+            bool skipped = false;
+            for (unsigned i : heap)
+            {
+                if (items[i].height <= room)
+                {
+                    room -= items[i].height;
+                    kept.push_back(i);
+                }
+                else
+                {
+                    skipped = true;
+                }
+            }
+
+            // If all K fit there's less room left than any candidate
+            // needs. Otherwise the next best get a turn at what's left.
+            if (!skipped)
+            {
+                break;
+            }
+            candidates.swap(rest);
+        }
+        std::sort(kept.begin(), kept.end());
+    }
+}
@@ -0,0 +1,26 @@
+#ifndef event_select_h
+#define event_select_h
+
+#include <vector>
+
+namespace Project
+{
+    // Chooses which events of an overflowing column are shown.
+    struct select_item
+    {
+        int importance;
+        int height;
+    };
+
+    // Keeps the most important items whose heights add up to at most
+    // room, earlier items first among equals. items are in time order,
+    // and kept gets the indices of the ones shown, also in time order.
+    //
+    // Only as many items as could possibly fit are ranked, K = room over
+    // the smallest height. A bounded heap picks them in O(n log K), and
+    // they're then placed most important first while they fit. Only if
+    // a tall one didn't fit are the rest ranked again for what's left.
+    void select_important(const std::vector<select_item> &items, int room, std::vector<unsigned> &kept);
+}
+
+#endif
@@ -0,0 +1,145 @@
+#include "font_store.h"
+
+#include <string.h>
+
+#ifdef ARDUINO
+#include <esp_partition.h>
+#endif
+
+namespace Project
+{
+    static_assert(sizeof(FontMetrics::glyph_metrics) == 12, "glyph record size is part of the font partition format");
+
+    namespace
+    {
+        struct store_header
+        {
+            uint32_t magic;
+            uint16_t version;
+            uint16_t font_count;
+        };
+
+        struct store_font
+        {
+            char name[FontStore::NAME_LENGTH];
+            uint32_t glyph_count;
+            uint32_t codepoints_offset;
+            uint32_t glyphs_offset;
+            uint32_t bitmap_offset;
+            uint32_t bitmap_size;
+            uint8_t y_advance;
+            uint8_t reserved[3];
+        };
+
+        bool in_bounds(size_t offset, size_t length, size_t size)
+        {
+            return offset <= size && length <= size - offset;
+        }
+    }
+
+    // Everything is checked up front, a bad image gives an empty store
+    // rather than reads outside the partition later
+    FontStore::FontStore(const uint8_t *data, size_t size)
+    {
+        if (size < sizeof(store_header))
+        {
+            return;
+        }
+        const store_header *header = reinterpret_cast<const store_header *>(data);
+        if (header->magic != MAGIC || header->version != VERSION ||
+            !in_bounds(sizeof(store_header), header->font_count * sizeof(store_font), size))
+        {
+            return;
+        }
+
+        const store_font *directory = reinterpret_cast<const store_font *>(data + sizeof(store_header));
+        for (unsigned i = 0; i < header->font_count; ++i)
+        {
+            const store_font &entry = directory[i];
+            size_t count = entry.glyph_count;
+            // Checked before the sizes below are multiplied out, those
+            // could wrap around with a 32 bit size_t
+            if (count > size / sizeof(FontMetrics::glyph_metrics) ||
+                entry.codepoints_offset % 4 != 0 || entry.glyphs_offset % 4 != 0 ||
+                !in_bounds(entry.codepoints_offset, count * sizeof(uint32_t), size) ||
+                !in_bounds(entry.glyphs_offset, count * sizeof(FontMetrics::glyph_metrics), size) ||
+                !in_bounds(entry.bitmap_offset, entry.bitmap_size, size))
+            {
+                continue;
+            }
+
+            const uint32_t *codepoints = reinterpret_cast<const uint32_t *>(data + entry.codepoints_offset);
+            const FontMetrics::glyph_metrics *glyphs =
+                reinterpret_cast<const FontMetrics::glyph_metrics *>(data + entry.glyphs_offset);
+            bool ok = true;
+            for (size_t g = 0; g < count && ok; ++g)
+            {
+                size_t bits = (size_t)glyphs[g].width * glyphs[g].height;
+                ok = (g == 0 || codepoints[g - 1] < codepoints[g]) &&
+                     in_bounds(glyphs[g].bitmap_offset, (bits + 7) / 8, entry.bitmap_size);
+            }
+            if (!ok)
+            {
+                continue;
+            }
+
+            font f;
+            memcpy(f.name, entry.name, NAME_LENGTH);
+            f.name[NAME_LENGTH - 1] = 0;
+            f.metrics = new FontMetrics(codepoints, glyphs, count, data + entry.bitmap_offset, entry.y_advance);
+            this->fonts.push_back(f);
+        }
+    }
+
+    FontStore::~FontStore()
+    {
+        for (font &f : this->fonts)
+        {
+            delete f.metrics;
+        }
+    }
+
+    FontStore *FontStore::open(const char *label)
+    {
+#ifdef ARDUINO
+        const esp_partition_t *partition =
+            esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+        if (partition == nullptr)
+        {
+            return nullptr;
+        }
+
+        // Mapped for good, the fonts are used until reset
+        const void *data;
+        spi_flash_mmap_handle_t handle;
+        if (esp_partition_mmap(partition, 0, partition->size, SPI_FLASH_MMAP_DATA, &data, &handle) != ESP_OK)
+        {
+            return nullptr;
+        }
+
+        FontStore *store = new FontStore(static_cast<const uint8_t *>(data), partition->size);
+        if (!store->valid())
+        {
+            delete store;
+            spi_flash_munmap(handle);
+            return nullptr;
+        }
+        return store;
+#else
+        (void)label;
+        return nullptr;
+#endif
+    }
+
+    const FontMetrics *FontStore::find(const char *name) const
+    {
+        for (const font &f : this->fonts)
+        {
+            if (strncmp(f.name, name, NAME_LENGTH) == 0)
+            {
+                return f.metrics;
+            }
+        }
+        return nullptr;
+    }
+}
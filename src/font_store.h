@@ -0,0 +1,61 @@
+#ifndef font_store_h
+#define font_store_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "text_layout.h"
+
+namespace Project
+{
+    // Fonts kept in their own flash partition rather than in the app
+    // image. The partition is memory mapped, so glyph tables and bitmaps
+    // are read in place and only paged into the flash cache when used.
+    //
+    // Layout, little endian, every table 4 byte aligned:
+    //
+    //   header      magic "RCFS", version, number of fonts
+    //   directory   per font: name, y advance, glyph count and the
+    //               offsets of its three tables
+    //   codepoints  uint32 per glyph, ascending
+    //   glyphs      FontMetrics::glyph_metrics per glyph
+    //   bitmaps     glyph bitmaps as in a GFXfont
+    //
+    // tools/fontstore.py builds an image from Adafruit GFX font headers.
+    class FontStore
+    {
+    public:
+        static const uint32_t MAGIC = 0x53464352; // "RCFS"
+        static const uint16_t VERSION = 1;
+        static const size_t NAME_LENGTH = 24;
+
+        // data must stay valid for as long as the store is used
+        FontStore(const uint8_t *data, size_t size);
+        ~FontStore();
+
+        FontStore(const FontStore &) = delete;
+        FontStore &operator=(const FontStore &) = delete;
+
+        // Maps the data partition with this label, nullptr if there is
+        // none or it doesn't hold a valid store
+        static FontStore *open(const char *label = "fonts");
+
+        bool valid() const { return !this->fonts.empty(); }
+        size_t size() const { return this->fonts.size(); }
+
+        // nullptr if the store has no font by that name
+        const FontMetrics *find(const char *name) const;
+
+    protected:
+        struct font
+        {
+            char name[NAME_LENGTH];
+            FontMetrics *metrics;
+        };
+
+        std::vector<font> fonts;
+    };
+}
+
+#endif
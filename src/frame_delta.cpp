@@ -0,0 +1,324 @@
+#include "frame_delta.h"
+
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hash.h"
+
+namespace Project
+{
+    namespace
+    {
+        const uint32_t DELTA_MAGIC = 0x44464352; // "RCFD"
+        const uint8_t DELTA_VERSION = 1;
+
+        // Stored little endian, as the ESP32 is
+        struct header
+        {
+            uint32_t magic;
+            uint8_t version;
+            uint8_t bits_per_pixel;
+            uint8_t rotation;
+            uint8_t reserved;
+            uint16_t width;
+            uint16_t height;
+            uint32_t tile_count;
+            uint64_t base_hash;
+            uint64_t frame_hash;
+        };
+
+        // Followed by packed_size bytes, the rows packed one at a time
+        struct tile_header
+        {
+            uint16_t x;
+            uint16_t y;
+            uint16_t width;
+            uint16_t height;
+            uint8_t op;
+            uint8_t reserved[3];
+            uint32_t packed_size;
+        };
+
+        static_assert(sizeof(header) == 32, "delta header layout");
+        static_assert(sizeof(tile_header) == 16, "delta tile header layout");
+
+        size_t stride_of(const delta_info &info)
+        {
+            return (size_t)info.width * info.bits_per_pixel / 8;
+        }
+
+        rle_sink_t append_to(std::vector<uint8_t> &out)
+        {
+            return [&out](const uint8_t *data, size_t len)
+            {
+                out.insert(out.end(), data, data + len);
+                return true;
+            };
+        }
+    }
+
+    uint64_t frame_hash(const uint8_t *frame, const delta_info &info)
+    {
+        return hash_bytes((const char *)frame, stride_of(info) * info.height);
+    }
+
+    size_t encode_frame_delta(delta_info &info, const uint8_t *base, const uint8_t *frame,
+                              const std::vector<Rect> &regions, const rle_sink_t &sink)
+    {
+        const size_t stride = stride_of(info);
+        const int pixels_per_byte = 8 / info.bits_per_pixel;
+
+        // Regions widened to whole bytes and clipped to the frame
+        std::vector<Rect> tiles;
+        for (const Rect &r : base != nullptr ? regions : std::vector<Rect>{Rect{0, 0, info.width, info.height}})
+        {
+            int x1 = r.x < 0 ? 0 : r.x / pixels_per_byte * pixels_per_byte;
+            int x2 = (r.x + r.w + pixels_per_byte - 1) / pixels_per_byte * pixels_per_byte;
+            int y1 = r.y < 0 ? 0 : r.y;
+            int y2 = r.y + r.h;
+            x2 = x2 > info.width ? info.width : x2;
+            y2 = y2 > info.height ? info.height : y2;
+            if (x2 > x1 && y2 > y1)
+            {
+                tiles.push_back(Rect{x1, y1, x2 - x1, y2 - y1});
+            }
+        }
+
+        info.tile_count = tiles.size();
+        info.base_hash = base != nullptr ? frame_hash(base, info) : 0;
+        info.frame_hash = frame_hash(frame, info);
+
+        header h = {};
+        h.magic = DELTA_MAGIC;
+        h.version = DELTA_VERSION;
+        h.bits_per_pixel = info.bits_per_pixel;
+        h.rotation = info.rotation;
+        h.width = info.width;
+        h.height = info.height;
+        h.tile_count = info.tile_count;
+        h.base_hash = info.base_hash;
+        h.frame_hash = info.frame_hash;
+        if (!sink((const uint8_t *)&h, sizeof(h)))
+        {
+            return 0;
+        }
+        size_t total = sizeof(h);
+
+        std::vector<uint8_t> replaced, xored, row;
+        for (const Rect &tile : tiles)
+        {
+            size_t x_bytes = (size_t)tile.x / pixels_per_byte;
+            size_t row_bytes = (size_t)tile.w / pixels_per_byte;
+
+            replaced.clear();
+            xored.clear();
+            row.resize(row_bytes);
+            for (int y = tile.y; y < tile.y + tile.h; ++y)
+            {
+                const uint8_t *src = frame + y * stride + x_bytes;
+                rle_encode(src, row_bytes, append_to(replaced));
+                if (base != nullptr)
+                {
+                    const uint8_t *old = base + y * stride + x_bytes;
+                    for (size_t i = 0; i < row_bytes; ++i)
+                    {
+                        row[i] = src[i] ^ old[i];
+                    }
+                    rle_encode(row.data(), row_bytes, append_to(xored));
+                }
+            }
+
+            // Unchanged pixels XOR to runs of zeros, so that usually wins
+            bool use_xor = base != nullptr && xored.size() < replaced.size();
+            const std::vector<uint8_t> &packed = use_xor ? xored : replaced;
+
+            tile_header t = {};
+            t.x = tile.x;
+            t.y = tile.y;
+            t.width = tile.w;
+            t.height = tile.h;
+            t.op = use_xor ? DELTA_XOR : DELTA_REPLACE;
+            t.packed_size = packed.size();
+            if (!sink((const uint8_t *)&t, sizeof(t)) || !sink(packed.data(), packed.size()))
+            {
+                return 0;
+            }
+            total += sizeof(t) + packed.size();
+        }
+        return total;
+    }
+
+    DeltaDecoder::DeltaDecoder(size_t max_row_bytes)
+        : frame(nullptr), stride(0), row(nullptr), max_row_bytes(max_row_bytes), rle(nullptr, 0)
+    {
+        this->row = static_cast<uint8_t *>(malloc(max_row_bytes));
+        if (this->row == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+        this->reset();
+    }
+
+    DeltaDecoder::~DeltaDecoder()
+    {
+        free(this->row);
+    }
+
+    void DeltaDecoder::reset()
+    {
+        this->state = HEADER;
+        this->header_used = 0;
+        this->frame = nullptr;
+    }
+
+    bool DeltaDecoder::gather(const uint8_t *data, size_t len, size_t &used, size_t want)
+    {
+        size_t copy = want - this->header_used;
+        if (copy > len - used)
+        {
+            copy = len - used;
+        }
+        memcpy(this->header_buffer + this->header_used, data + used, copy);
+        this->header_used += copy;
+        used += copy;
+        return this->header_used == want;
+    }
+
+    size_t DeltaDecoder::feed(const uint8_t *data, size_t len)
+    {
+        size_t used = 0;
+        while (used < len)
+        {
+            switch (this->state)
+            {
+            case HEADER:
+            {
+                if (!this->gather(data, len, used, sizeof(header)))
+                {
+                    break;
+                }
+                header h;
+                memcpy(&h, this->header_buffer, sizeof(h));
+                if (h.magic != DELTA_MAGIC || h.version != DELTA_VERSION ||
+                    (h.bits_per_pixel != 1 && h.bits_per_pixel != 4) ||
+                    (size_t)h.width * h.bits_per_pixel / 8 > this->max_row_bytes)
+                {
+                    this->state = FAILED;
+                    return used;
+                }
+                this->header_info = delta_info{h.bits_per_pixel, h.rotation, h.width, h.height,
+                                               h.tile_count, h.base_hash, h.frame_hash};
+                this->state = WAIT_FRAME;
+                return used;
+            }
+
+            case TILE_HEADER:
+                if (this->gather(data, len, used, sizeof(tile_header)) && !this->beginTile())
+                {
+                    this->state = FAILED;
+                    return used;
+                }
+                break;
+
+            case TILE_ROWS:
+            {
+                size_t available = len - used < this->tile_packed_left ? len - used : this->tile_packed_left;
+                size_t consumed = this->rle.consume(data + used, available);
+                used += consumed;
+                this->tile_packed_left -= consumed;
+                if (this->rle.done())
+                {
+                    this->endRow();
+                }
+                else if (this->rle.error() || this->tile_packed_left == 0)
+                {
+                    this->state = FAILED;
+                    return used;
+                }
+                break;
+            }
+
+            default:
+                return used;
+            }
+        }
+        return used;
+    }
+
+    void DeltaDecoder::start(uint8_t *frame)
+    {
+        this->frame = frame;
+        this->stride = stride_of(this->header_info);
+        this->tiles_left = this->header_info.tile_count;
+        this->header_used = 0;
+        this->state = this->tiles_left > 0 ? TILE_HEADER : DONE;
+    }
+
+    bool DeltaDecoder::beginTile()
+    {
+        tile_header t;
+        memcpy(&t, this->header_buffer, sizeof(t));
+
+        const delta_info &info = this->header_info;
+        const unsigned bpp = info.bits_per_pixel;
+        if (t.op > DELTA_XOR || t.width == 0 || t.height == 0 ||
+            (t.x * bpp) % 8 != 0 || (t.width * bpp) % 8 != 0 ||
+            t.x + t.width > info.width || t.y + t.height > info.height)
+        {
+            return false;
+        }
+
+        this->tile_x_bytes = t.x * bpp / 8;
+        this->tile_y = t.y;
+        this->tile_rows = t.height;
+        this->tile_row_bytes = (size_t)t.width * bpp / 8;
+        this->tile_op = t.op;
+        this->tile_packed_left = t.packed_size;
+        this->row_index = 0;
+        this->state = TILE_ROWS;
+        this->beginRow();
+        return true;
+    }
+
+    // Replaced rows unpack straight into the frame, XORed ones go
+    // through the row buffer
+    void DeltaDecoder::beginRow()
+    {
+        uint8_t *dst = this->frame + (this->tile_y + this->row_index) * this->stride + this->tile_x_bytes;
+        this->rle.reset(this->tile_op == DELTA_REPLACE ? dst : this->row, this->tile_row_bytes);
+    }
+
+    void DeltaDecoder::endRow()
+    {
+        if (this->tile_op == DELTA_XOR)
+        {
+            uint8_t *dst = this->frame + (this->tile_y + this->row_index) * this->stride + this->tile_x_bytes;
+            for (size_t i = 0; i < this->tile_row_bytes; ++i)
+            {
+                dst[i] ^= this->row[i];
+            }
+        }
+
+        if (++this->row_index < this->tile_rows)
+        {
+            this->beginRow();
+            return;
+        }
+
+        // Tile done, it must have used exactly its packed bytes
+        if (this->tile_packed_left != 0)
+        {
+            this->state = FAILED;
+        }
+        else if (--this->tiles_left == 0)
+        {
+            this->state = DONE;
+        }
+        else
+        {
+            this->header_used = 0;
+            this->state = TILE_HEADER;
+        }
+    }
+}
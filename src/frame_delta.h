@@ -0,0 +1,124 @@
+#ifndef frame_delta_h
+#define frame_delta_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "rect.h"
+#include "rle.h"
+
+namespace Project
+{
+    // Frames rendered somewhere else, sent as changes to the packed
+    // framebuffer.
+    //
+    // A delta is a header followed by tiles. A tile is a rectangle of the
+    // framebuffer (before rotation, byte aligned) that either replaces
+    // what is there or is XORed onto it, stored as PackBits packed rows.
+    // A key frame has no base and replaces the whole frame; any other
+    // delta only applies to the frame whose hash it names as its base.
+    struct delta_info
+    {
+        uint8_t bits_per_pixel;
+        uint8_t rotation;
+        uint16_t width;
+        uint16_t height;
+        uint32_t tile_count;
+        // Of the frame the delta applies to, 0 for a key frame, and of
+        // the frame it results in
+        uint64_t base_hash;
+        uint64_t frame_hash;
+    };
+
+    enum delta_op : uint8_t
+    {
+        DELTA_REPLACE,
+        DELTA_XOR
+    };
+
+    // Hash of a whole framebuffer, as used for base_hash and frame_hash
+    uint64_t frame_hash(const uint8_t *frame, const delta_info &info);
+
+    // Packs the change from base to frame, one tile per region, each
+    // XORed or replaced whichever packs smaller. Without a base it packs
+    // a key frame. Fills in the tile count and hashes of info. Returns
+    // the number of bytes written, 0 on failure.
+    //
+    // Uses no shared state, so a renderer can encode for many panels at
+    // once, one thread each.
+    size_t encode_frame_delta(delta_info &info, const uint8_t *base, const uint8_t *frame,
+                              const std::vector<Rect> &regions, const rle_sink_t &sink);
+
+    // Applies a delta to a framebuffer as the data arrives, in pieces of
+    // any size. Besides the framebuffer itself it only needs one row.
+    //
+    // Decoding stops after the header, so the caller can check it
+    // against the framebuffer before calling start().
+    class DeltaDecoder
+    {
+    public:
+        DeltaDecoder(size_t max_row_bytes);
+        ~DeltaDecoder();
+
+        DeltaDecoder(const DeltaDecoder &) = delete;
+        DeltaDecoder &operator=(const DeltaDecoder &) = delete;
+
+        // Ready for the next delta
+        void reset();
+
+        // Returns how much of data was used. Stops once the header is
+        // in, and at the end of the delta.
+        size_t feed(const uint8_t *data, size_t len);
+
+        // The header is in, waiting for start()
+        bool ready() const { return this->state == WAIT_FRAME; }
+        const delta_info &info() const { return this->header_info; }
+
+        // Apply the tiles to frame, laid out as the header says
+        void start(uint8_t *frame);
+
+        bool done() const { return this->state == DONE; }
+        bool error() const { return this->state == FAILED; }
+
+    protected:
+        enum state_t
+        {
+            HEADER,
+            WAIT_FRAME,
+            TILE_HEADER,
+            TILE_ROWS,
+            DONE,
+            FAILED
+        };
+
+        // Fill the header buffer, true once it holds want bytes
+        bool gather(const uint8_t *data, size_t len, size_t &used, size_t want);
+        bool beginTile();
+        void beginRow();
+        void endRow();
+
+        state_t state;
+        delta_info header_info;
+        uint8_t *frame;
+        size_t stride;
+
+        uint8_t *row;
+        size_t max_row_bytes;
+        RleDecoder rle;
+
+        uint8_t header_buffer[32];
+        size_t header_used;
+
+        uint32_t tiles_left;
+        int tile_x_bytes;
+        int tile_y;
+        int tile_rows;
+        size_t tile_row_bytes;
+        uint8_t tile_op;
+        uint32_t tile_packed_left;
+        int row_index;
+    };
+}
+
+#endif
@@ -0,0 +1,149 @@
+#include "frame_diff.h"
+
+#include <string.h>
+
+namespace Project
+{
+    TileDiff::TileDiff(int width, int height, int bits_per_pixel)
+        : width(width), height(height)
+    {
+        this->tiles_x = (width + TILE_SIZE - 1) / TILE_SIZE;
+        this->tiles_y = (height + TILE_SIZE - 1) / TILE_SIZE;
+        this->hashes.resize(this->tiles_x * this->tiles_y);
+        this->next_hashes.resize(this->tiles_x * this->tiles_y);
+        this->dirty.resize(this->tiles_x * this->tiles_y);
+        this->reset(bits_per_pixel);
+    }
+
+    void TileDiff::reset(int bits_per_pixel)
+    {
+        this->bits_per_pixel = bits_per_pixel;
+        this->invalidate();
+    }
+
+    void TileDiff::invalidate()
+    {
+        this->valid = false;
+    }
+
+    void TileDiff::update(const uint8_t *frame)
+    {
+        const size_t stride = (size_t)this->width * this->bits_per_pixel / 8;
+        const size_t tile_bytes = (size_t)TILE_SIZE * this->bits_per_pixel / 8;
+
+        // One pass over the frame in memory order; every row adds its
+        // slice of each tile to that tile's hash, a word at a time. The
+        // multiply only carries changes upwards, so the top half is
+        // folded back down after each word, otherwise changes to the
+        // high byte of a few rows (the right edge of a 1-bit tile) can
+        // cancel each other out.
+        for (int ty = 0; ty < this->tiles_y; ++ty)
+        {
+            uint32_t *row_hashes = &this->next_hashes[ty * this->tiles_x];
+            for (int tx = 0; tx < this->tiles_x; ++tx)
+            {
+                row_hashes[tx] = 2166136261u;
+            }
+
+            int y_end = (ty + 1) * TILE_SIZE < this->height ? (ty + 1) * TILE_SIZE : this->height;
+            for (int y = ty * TILE_SIZE; y < y_end; ++y)
+            {
+                const uint8_t *row = frame + y * stride;
+                for (int tx = 0; tx < this->tiles_x; ++tx)
+                {
+                    size_t begin = tx * tile_bytes;
+                    size_t end = begin + tile_bytes < stride ? begin + tile_bytes : stride;
+                    uint32_t hash = row_hashes[tx];
+                    size_t i = begin;
+                    for (; i + 4 <= end; i += 4)
+                    {
+                        uint32_t word;
+                        memcpy(&word, row + i, 4);
+                        hash = (hash ^ word) * 16777619u;
+                        hash ^= hash >> 16;
+                    }
+                    for (; i < end; ++i)
+                    {
+                        hash = (hash ^ row[i]) * 16777619u;
+                    }
+                    row_hashes[tx] = hash;
+                }
+            }
+        }
+
+        this->dirty_count = 0;
+        this->dirty_area = 0;
+        for (int ty = 0; ty < this->tiles_y; ++ty)
+        {
+            for (int tx = 0; tx < this->tiles_x; ++tx)
+            {
+                int i = ty * this->tiles_x + tx;
+                bool changed = !this->valid || this->hashes[i] != this->next_hashes[i];
+                this->dirty[i] = changed;
+                if (changed)
+                {
+                    int w = this->width - tx * TILE_SIZE < TILE_SIZE ? this->width - tx * TILE_SIZE : TILE_SIZE;
+                    int h = this->height - ty * TILE_SIZE < TILE_SIZE ? this->height - ty * TILE_SIZE : TILE_SIZE;
+                    ++this->dirty_count;
+                    this->dirty_area += w * h;
+                }
+            }
+        }
+
+        this->merge_regions();
+    }
+
+    void TileDiff::commit()
+    {
+        this->hashes.swap(this->next_hashes);
+        this->valid = true;
+    }
+
+    // Joins horizontal runs of dirty tiles, then stacks runs with the
+    // same horizontal extent in consecutive tile rows.
+    void TileDiff::merge_regions()
+    {
+        this->dirty_regions.clear();
+
+        for (int ty = 0; ty < this->tiles_y; ++ty)
+        {
+            size_t row_begin = this->dirty_regions.size();
+            int tx = 0;
+            while (tx < this->tiles_x)
+            {
+                if (!this->dirty[ty * this->tiles_x + tx])
+                {
+                    ++tx;
+                    continue;
+                }
+                int run_start = tx;
+                while (tx < this->tiles_x && this->dirty[ty * this->tiles_x + tx])
+                {
+                    ++tx;
+                }
+
+                Rect rect;
+                rect.x = run_start * TILE_SIZE;
+                rect.y = ty * TILE_SIZE;
+                rect.w = (tx * TILE_SIZE < this->width ? tx * TILE_SIZE : this->width) - rect.x;
+                rect.h = ((ty + 1) * TILE_SIZE < this->height ? (ty + 1) * TILE_SIZE : this->height) - rect.y;
+
+                bool merged = false;
+                for (size_t i = 0; i < row_begin; ++i)
+                {
+                    Rect &above = this->dirty_regions[i];
+                    if (above.x == rect.x && above.w == rect.w && above.y + above.h == rect.y)
+                    {
+                        above.h += rect.h;
+                        merged = true;
+                        break;
+                    }
+                }
+                if (!merged)
+                {
+                    this->dirty_regions.push_back(rect);
+                }
+            }
+        }
+    }
+}
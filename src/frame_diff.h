@@ -0,0 +1,60 @@
+#ifndef frame_diff_h
+#define frame_diff_h
+
+#include <stdint.h>
+#include <vector>
+
+#include "rect.h"
+
+namespace Project
+{
+    // Finds which parts of a packed framebuffer changed since the last
+    // frame, by hashing fixed size tiles and comparing the hashes.
+    //
+    // Coordinates are those of the framebuffer, i.e. before rotation.
+    class TileDiff
+    {
+    public:
+        static const int TILE_SIZE = 32;
+
+        TileDiff(int width, int height, int bits_per_pixel);
+
+        // Hashes frame and compares it with the last committed one
+        void update(const uint8_t *frame);
+
+        // The frame passed to update() is now what the panel shows
+        void commit();
+
+        // Next update() treats every tile as dirty
+        void invalidate();
+
+        // Layout of the framebuffer changed, e.g. a new display mode
+        void reset(int bits_per_pixel);
+
+        unsigned dirty_tiles() const { return this->dirty_count; }
+        unsigned total_tiles() const { return this->tiles_x * this->tiles_y; }
+        uint32_t dirty_pixels() const { return this->dirty_area; }
+        float dirty_fraction() const { return (float)this->dirty_area / ((float)this->width * this->height); }
+
+        // Dirty tiles merged into rectangles
+        const std::vector<Rect> &regions() const { return this->dirty_regions; }
+
+    protected:
+        void merge_regions();
+
+        int width;
+        int height;
+        int bits_per_pixel;
+        int tiles_x;
+        int tiles_y;
+        bool valid;
+        unsigned dirty_count;
+        uint32_t dirty_area;
+        std::vector<uint32_t> hashes;
+        std::vector<uint32_t> next_hashes;
+        std::vector<bool> dirty;
+        std::vector<Rect> dirty_regions;
+    };
+}
+
+#endif
@@ -0,0 +1,48 @@
+#include "frame_layer.h"
+
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef BOARD_HAS_PSRAM
+#include <esp32-hal-psram.h>
+#endif
+
+namespace Project
+{
+    FrameLayer::FrameLayer(size_t capacity)
+        : buffer(nullptr), buffer_size(capacity), bytes(0), key(0), is_valid(false)
+    {
+#ifdef BOARD_HAS_PSRAM
+        this->buffer = static_cast<uint8_t *>(ps_malloc(capacity));
+#else
+        this->buffer = static_cast<uint8_t *>(malloc(capacity));
+#endif
+        if (this->buffer == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+    }
+
+    FrameLayer::~FrameLayer()
+    {
+        free(this->buffer);
+    }
+
+    uint8_t *FrameLayer::redraw(uint64_t key, size_t bytes)
+    {
+        if (bytes > this->buffer_size)
+        {
+            throw std::bad_alloc();
+        }
+        this->bytes = bytes;
+        this->key = key;
+        this->is_valid = true;
+        return this->buffer;
+    }
+
+    void FrameLayer::restore(uint8_t *frame) const
+    {
+        memcpy(frame, this->buffer, this->bytes);
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef frame_layer_h
+#define frame_layer_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Project
+{
+    // A framebuffer sized copy of content that rarely changes, kept in
+    // PSRAM. The key says what it was drawn for (e.g. date and rotation);
+    // while it matches, each frame starts with a copy of the layer
+    // instead of drawing that content again.
+    class FrameLayer
+    {
+    public:
+        // Room for the largest framebuffer the layer will be drawn for
+        FrameLayer(size_t capacity);
+        ~FrameLayer();
+
+        FrameLayer(const FrameLayer &) = delete;
+        FrameLayer &operator=(const FrameLayer &) = delete;
+
+        bool valid(uint64_t key) const { return this->is_valid && this->key == key; }
+
+        // Buffer of bytes to draw the layer into for key, the layer
+        // counts as valid from here on
+        uint8_t *redraw(uint64_t key, size_t bytes);
+        void invalidate() { this->is_valid = false; }
+
+        // Copy the layer over the whole of frame
+        void restore(uint8_t *frame) const;
+
+        size_t size() const { return this->bytes; }
+        size_t capacity() const { return this->buffer_size; }
+
+    protected:
+        uint8_t *buffer;
+        size_t buffer_size;
+        size_t bytes;
+        uint64_t key;
+        bool is_valid;
+    };
+}
+
+#endif
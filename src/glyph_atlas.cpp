@@ -0,0 +1,189 @@
+#include "glyph_atlas.h"
+
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#ifdef BOARD_HAS_PSRAM
+#include <esp32-hal-psram.h>
+#endif
+
+namespace Project
+{
+    static void *atlas_alloc(size_t size)
+    {
+#ifdef BOARD_HAS_PSRAM
+        void *ptr = ps_malloc(size);
+#else
+        void *ptr = malloc(size);
+#endif
+        if (ptr == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+        return ptr;
+    }
+
+    // Where pixel (xx, yy) of a w x h glyph ends up relative to the top
+    // left of its rotated box, the same mapping as Raster::pixel
+    static void rotate(int rotation, int w, int h, int xx, int yy, int &col, int &row)
+    {
+        switch (rotation)
+        {
+        case 1:
+            col = h - 1 - yy;
+            row = xx;
+            break;
+        case 2:
+            col = w - 1 - xx;
+            row = h - 1 - yy;
+            break;
+        case 3:
+            col = yy;
+            row = w - 1 - xx;
+            break;
+        default:
+            col = xx;
+            row = yy;
+            break;
+        }
+    }
+
+    // Masks are allocated from blocks of at least this size
+    static const size_t ATLAS_BLOCK_SIZE = 16 * 1024;
+
+    GlyphAtlas::GlyphAtlas(const FontMetrics &metrics, int rotation, Raster::Format format)
+        : metrics(&metrics), rotation(rotation & 3), format(format), entries(nullptr),
+          added(metrics.count(), false), block_next(nullptr), block_free(0), size(0)
+    {
+        this->entries = static_cast<entry *>(atlas_alloc(metrics.count() * sizeof(entry)));
+        memset(this->entries, 0, metrics.count() * sizeof(entry));
+    }
+
+    uint8_t *GlyphAtlas::allocate(size_t bytes)
+    {
+        if (bytes > this->block_free)
+        {
+            size_t block_size = bytes > ATLAS_BLOCK_SIZE ? bytes : ATLAS_BLOCK_SIZE;
+            this->block_next = static_cast<uint8_t *>(atlas_alloc(block_size));
+            this->block_free = block_size;
+        }
+        uint8_t *ptr = this->block_next;
+        this->block_next += bytes;
+        this->block_free -= bytes;
+        this->size += bytes;
+        return ptr;
+    }
+
+    void GlyphAtlas::add(const FontMetrics::glyph_metrics *glyph)
+    {
+        unsigned index = this->metrics->index(glyph);
+        if (this->added[index])
+        {
+            return;
+        }
+        this->added[index] = true;
+
+        entry &e = this->entries[index];
+        e.width = this->rotation & 1 ? glyph->height : glyph->width;
+        e.height = this->rotation & 1 ? glyph->width : glyph->height;
+        if (e.width == 0 || e.height == 0)
+        {
+            return;
+        }
+
+        // Both phases back to back
+        int phases = this->format == Raster::MONO ? 1 : 2;
+        size_t bytes = 0;
+        for (int phase = 0; phase < phases; ++phase)
+        {
+            e.stride[phase] = this->format == Raster::MONO ? (e.width + 7) / 8 : (phase + e.width + 1) / 2;
+            bytes += e.stride[phase] * e.height;
+        }
+        uint8_t *masks = this->allocate(bytes);
+        memset(masks, 0, bytes);
+        e.mask[0] = masks;
+        e.mask[1] = phases > 1 ? masks + e.stride[0] * e.height : nullptr;
+
+        const uint8_t *bitmap = this->metrics->bitmap() + glyph->bitmap_offset;
+        unsigned bit = 0;
+        uint8_t bits = 0;
+        for (int yy = 0; yy < glyph->height; ++yy)
+        {
+            for (int xx = 0; xx < glyph->width; ++xx, ++bit)
+            {
+                if ((bit & 7) == 0)
+                {
+                    bits = bitmap[bit >> 3];
+                }
+                if (bits & 0x80)
+                {
+                    int col, row;
+                    rotate(this->rotation, glyph->width, glyph->height, xx, yy, col, row);
+                    if (this->format == Raster::MONO)
+                    {
+                        masks[row * e.stride[0] + col / 8] |= 1 << (col & 7);
+                    }
+                    else
+                    {
+                        for (int phase = 0; phase < 2; ++phase)
+                        {
+                            int px = col + phase;
+                            e.mask[phase][row * e.stride[phase] + px / 2] |= px & 1 ? 0x0f : 0xf0;
+                        }
+                    }
+                }
+                bits <<= 1;
+            }
+        }
+    }
+
+    void GlyphAtlas::addAll()
+    {
+        for (unsigned i = 0; i < this->metrics->count(); ++i)
+        {
+            this->add(this->metrics->at(i));
+        }
+    }
+
+    GlyphAtlas &GlyphAtlas::get(const FontMetrics &metrics, int rotation, Raster::Format format)
+    {
+        // One per font, rotation and format actually used, a list is plenty
+        static std::vector<GlyphAtlas *> cache;
+        for (GlyphAtlas *atlas : cache)
+        {
+            if (atlas->metrics == &metrics && atlas->rotation == (rotation & 3) && atlas->format == format)
+            {
+                return *atlas;
+            }
+        }
+        GlyphAtlas *atlas = new GlyphAtlas(metrics, rotation, format);
+        cache.push_back(atlas);
+        return *atlas;
+    }
+
+    void GlyphAtlas::draw(Raster &raster, int x, int y, const FontMetrics::glyph_metrics *glyph, uint8_t color) const
+    {
+        this->drawPanel(raster, raster.toPanel(Rect{x + glyph->offset, y + glyph->y_offset, glyph->width, glyph->height}),
+                        glyph, color);
+    }
+
+    void GlyphAtlas::drawPanel(Raster &raster, const Rect &panel, const FontMetrics::glyph_metrics *glyph, uint8_t color) const
+    {
+        const entry &e = this->entries[this->metrics->index(glyph)];
+        if (e.width == 0 || e.height == 0)
+        {
+            return;
+        }
+
+        if (this->format == Raster::MONO)
+        {
+            raster.blitBits(panel.x, panel.y, e.stride[0], e.height, e.mask[0], e.stride[0], color);
+            return;
+        }
+        int phase = panel.x & 1;
+        raster.blitMask(panel.x - phase, panel.y, e.stride[phase], e.height,
+                        e.mask[phase], e.stride[phase], color);
+    }
+}
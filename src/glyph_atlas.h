@@ -0,0 +1,72 @@
+#ifndef glyph_atlas_h
+#define glyph_atlas_h
+
+#include <stdint.h>
+#include <vector>
+
+#include "raster.h"
+#include "text_layout.h"
+
+namespace Project
+{
+    // Glyphs of a font, rotated and expanded into a framebuffer format
+    // ahead of time, so drawing a glyph is a masked write per
+    // framebuffer byte instead of unpacking bits pixel by pixel. Glyphs
+    // are expanded as they are first used, so large fonts only cost
+    // memory for the characters actually shown.
+    //
+    // For 3-bit frames each glyph is kept twice, for starting on an even
+    // and on an odd panel column. A mask byte is 0xf0, 0x0f, 0xff or 0
+    // depending on which of the two pixels of the framebuffer byte below
+    // it are ink. For 1-bit frames glyphs are kept once as rows of bits
+    // in frame order and shifted into place while drawing.
+    class GlyphAtlas
+    {
+    public:
+        // Creates the atlas on first use. Neither this nor add() is
+        // thread safe, so add the glyphs a frame needs before rendering
+        // it on several cores.
+        static GlyphAtlas &get(const FontMetrics &metrics, int rotation, Raster::Format format = Raster::GRAY3);
+
+        void add(const FontMetrics::glyph_metrics *glyph);
+        void addAll();
+
+        // Glyph with its origin (baseline, left of the advance) at x, y.
+        // Glyphs that haven't been added are skipped.
+        void draw(Raster &raster, int x, int y, const FontMetrics::glyph_metrics *glyph, uint8_t color) const;
+
+        // Glyph whose box is already mapped to the panel
+        void drawPanel(Raster &raster, const Rect &panel, const FontMetrics::glyph_metrics *glyph, uint8_t color) const;
+
+        size_t bytes() const { return this->size; }
+
+        GlyphAtlas(const GlyphAtlas &) = delete;
+        GlyphAtlas &operator=(const GlyphAtlas &) = delete;
+
+    protected:
+        struct entry
+        {
+            uint8_t *mask[2];
+            uint8_t stride[2];
+            uint8_t width;
+            uint8_t height;
+        };
+
+        GlyphAtlas(const FontMetrics &metrics, int rotation, Raster::Format format);
+
+        uint8_t *allocate(size_t bytes);
+
+        const FontMetrics *metrics;
+        int rotation;
+        Raster::Format format;
+        entry *entries;
+        std::vector<bool> added;
+
+        // Masks are carved out of blocks that are never moved or freed
+        uint8_t *block_next;
+        size_t block_free;
+        size_t size;
+    };
+}
+
+#endif
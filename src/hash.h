@@ -0,0 +1,34 @@
+#ifndef hash_h
+#define hash_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Project
+{
+    // 64 bit FNV-1a, cheap and good enough for short keys like event ids.
+    inline uint64_t hash_bytes(const char *data, size_t len)
+    {
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        for (size_t i = 0; i < len; ++i)
+        {
+            hash ^= (uint8_t)data[i];
+            hash *= 0x100000001b3ULL;
+        }
+        return hash;
+    }
+
+    // splitmix64 finaliser, spreads nearby integers (e.g. timestamps)
+    // across all bits.
+    inline uint64_t hash_mix(uint64_t value)
+    {
+        value ^= value >> 30;
+        value *= 0xbf58476d1ce4e5b9ULL;
+        value ^= value >> 27;
+        value *= 0x94d049bb133111ebULL;
+        value ^= value >> 31;
+        return value;
+    }
+}
+
+#endif
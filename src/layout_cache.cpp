@@ -0,0 +1,205 @@
+#include "layout_cache.h"
+
+#include <new>
+#include <stdlib.h>
+
+#ifdef BOARD_HAS_PSRAM
+#include <esp32-hal-psram.h>
+#endif
+
+namespace Project
+{
+    static void *cache_alloc(size_t size)
+    {
+#ifdef BOARD_HAS_PSRAM
+        void *ptr = ps_malloc(size);
+#else
+        void *ptr = malloc(size);
+#endif
+        if (ptr == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+        return ptr;
+    }
+
+    LayoutCache::LayoutCache(size_t capacity)
+    {
+        if (capacity >= NIL)
+        {
+            capacity = NIL - 1;
+        }
+        this->slots_size = capacity;
+
+        size_t buckets = 8;
+        while (buckets < capacity * 2)
+        {
+            buckets *= 2;
+        }
+        this->mask = buckets - 1;
+
+        this->slots = (slot *)cache_alloc(capacity * sizeof(slot));
+        this->buckets = (uint16_t *)cache_alloc(buckets * sizeof(uint16_t));
+        this->clear();
+        this->reset_stats();
+    }
+
+    LayoutCache::~LayoutCache()
+    {
+        free(this->slots);
+        free(this->buckets);
+    }
+
+    void LayoutCache::clear()
+    {
+        for (size_t i = 0; i <= this->mask; ++i)
+        {
+            this->buckets[i] = NIL;
+        }
+        this->count = 0;
+        this->head = NIL;
+        this->tail = NIL;
+    }
+
+    void LayoutCache::reset_stats()
+    {
+        this->counters = Stats{0, 0, 0, 0};
+    }
+
+    // Second hash of the text for confirming a hit, unrelated to FNV-1a so
+    // texts that collide in one are not likely to collide in the other.
+    static uint64_t check_bytes(const char *data, size_t len)
+    {
+        uint64_t hash = len;
+        for (size_t i = 0; i < len; ++i)
+        {
+            hash = (hash + (uint8_t)data[i] + 1) * 0x9e3779b97f4a7c15ULL;
+            hash ^= hash >> 29;
+        }
+        return hash_mix(hash);
+    }
+
+    LayoutCache::entry_key LayoutCache::make_key(const FontMetrics &metrics, const string_ref &text, int max_width)
+    {
+        entry_key key;
+        key.hash = hash_bytes(text.data(), text.length());
+        key.hash ^= hash_mix((uint64_t)(uintptr_t)&metrics ^ ((uint64_t)max_width << 48));
+        key.check = check_bytes(text.data(), text.length());
+        key.metrics = &metrics;
+        key.max_width = max_width;
+        key.length = text.length();
+        return key;
+    }
+
+    // Returns the bucket holding key, or the empty bucket where it would go.
+    // Entries whose hash collides with key but that differ in anything else
+    // are probed past like any other.
+    size_t LayoutCache::probe(const entry_key &key) const
+    {
+        size_t i = key.hash & this->mask;
+        while (this->buckets[i] != NIL && !(this->slots[this->buckets[i]].key == key))
+        {
+            i = (i + 1) & this->mask;
+        }
+        return i;
+    }
+
+    // Backward shift deletion, as in EventIndex.
+    void LayoutCache::erase_bucket(size_t i)
+    {
+        size_t j = i;
+        while (true)
+        {
+            j = (j + 1) & this->mask;
+            if (this->buckets[j] == NIL)
+            {
+                break;
+            }
+            size_t home = this->slots[this->buckets[j]].key.hash & this->mask;
+            if (((j - home) & this->mask) >= ((j - i) & this->mask))
+            {
+                this->buckets[i] = this->buckets[j];
+                i = j;
+            }
+        }
+        this->buckets[i] = NIL;
+    }
+
+    void LayoutCache::unlink(uint16_t index)
+    {
+        slot &s = this->slots[index];
+        if (s.prev != NIL)
+            this->slots[s.prev].next = s.next;
+        else
+            this->head = s.next;
+        if (s.next != NIL)
+            this->slots[s.next].prev = s.prev;
+        else
+            this->tail = s.prev;
+    }
+
+    void LayoutCache::push_front(uint16_t index)
+    {
+        slot &s = this->slots[index];
+        s.prev = NIL;
+        s.next = this->head;
+        if (this->head != NIL)
+            this->slots[this->head].prev = index;
+        this->head = index;
+        if (this->tail == NIL)
+            this->tail = index;
+    }
+
+    TextLayout LayoutCache::layout(const FontMetrics &metrics, const string_ref &text, int max_width)
+    {
+        entry_key key = make_key(metrics, text, max_width);
+        size_t bucket = this->probe(key);
+
+        if (this->buckets[bucket] != NIL)
+        {
+            ++this->counters.hits;
+            uint16_t index = this->buckets[bucket];
+            this->unlink(index);
+            this->push_front(index);
+            const slot &s = this->slots[index];
+            return TextLayout{s.lines, s.count, s.height};
+        }
+
+        ++this->counters.misses;
+        wrap_text(metrics, text, max_width, this->spill);
+        unsigned height = this->spill.size() * metrics.yAdvance();
+
+        if (this->spill.size() > MAX_LINES || this->slots_size == 0)
+        {
+            ++this->counters.uncached;
+            return TextLayout{this->spill.data(), (unsigned)this->spill.size(), height};
+        }
+
+        uint16_t index;
+        if (this->count < this->slots_size)
+        {
+            index = this->count++;
+        }
+        else
+        {
+            // Evict the least recently used entry
+            ++this->counters.evictions;
+            index = this->tail;
+            this->unlink(index);
+            this->erase_bucket(this->probe(this->slots[index].key));
+            bucket = this->probe(key);
+        }
+
+        slot &s = this->slots[index];
+        s.key = key;
+        s.height = height;
+        s.count = this->spill.size();
+        for (unsigned i = 0; i < s.count; ++i)
+        {
+            s.lines[i] = this->spill[i];
+        }
+        this->buckets[bucket] = index;
+        this->push_front(index);
+        return TextLayout{s.lines, s.count, s.height};
+    }
+}
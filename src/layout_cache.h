@@ -0,0 +1,102 @@
+#ifndef layout_cache_h
+#define layout_cache_h
+
+#include <stdint.h>
+#include <vector>
+
+#include "text_layout.h"
+
+namespace Project
+{
+    // Result of wrapping a piece of text. Points into the cache, so it is
+    // only valid until the next call to LayoutCache::layout().
+    struct TextLayout
+    {
+        const TextLine *lines;
+        unsigned count;
+        unsigned height;
+    };
+
+    // Memoises wrap_text() across refreshes, keyed by a hash of the text,
+    // the font and the width. A hit also has to match the font, width,
+    // text length and a second hash of the text, so two titles whose keys
+    // collide never share lines. Least recently used entries are evicted.
+    class LayoutCache
+    {
+    public:
+        // Titles that wrap to more lines than this are laid out but not
+        // cached, they will not fit in a column anyway.
+        static const unsigned MAX_LINES = 8;
+
+        struct Stats
+        {
+            unsigned hits;
+            unsigned misses;
+            unsigned evictions;
+            unsigned uncached;
+        };
+
+        LayoutCache(size_t capacity);
+        ~LayoutCache();
+
+        LayoutCache(const LayoutCache &) = delete;
+        LayoutCache &operator=(const LayoutCache &) = delete;
+
+        TextLayout layout(const FontMetrics &metrics, const string_ref &text, int max_width);
+
+        void clear();
+        size_t size() const { return this->count; }
+        size_t capacity() const { return this->slots_size; }
+
+        const Stats &stats() const { return this->counters; }
+        void reset_stats();
+
+    protected:
+        static const uint16_t NIL = 0xffff;
+
+        struct entry_key
+        {
+            uint64_t hash;
+            uint64_t check;
+            const FontMetrics *metrics;
+            int32_t max_width;
+            uint32_t length;
+
+            bool operator==(const entry_key &other) const
+            {
+                return this->hash == other.hash && this->check == other.check &&
+                       this->metrics == other.metrics && this->max_width == other.max_width &&
+                       this->length == other.length;
+            }
+        };
+
+        struct slot
+        {
+            entry_key key;
+            uint16_t prev;
+            uint16_t next;
+            uint16_t height;
+            uint8_t count;
+            TextLine lines[MAX_LINES];
+        };
+
+        static entry_key make_key(const FontMetrics &metrics, const string_ref &text, int max_width);
+
+        size_t probe(const entry_key &key) const;
+        void unlink(uint16_t index);
+        void push_front(uint16_t index);
+        void erase_bucket(size_t bucket);
+
+        slot *slots;
+        uint16_t *buckets;
+        size_t slots_size;
+        size_t mask;
+        size_t count;
+        uint16_t head;
+        uint16_t tail;
+        Stats counters;
+        std::vector<TextLine> spill;
+    };
+}
+
+#endif
@@ -1,5 +1,6 @@
 #include "mystring.h"
 
+#include <algorithm>
 #include <ostream>
 
 #include "error.h"
@@ -7,8 +8,6 @@
 namespace Project
 {
     const char *endl = "\n";
-    const char *fmt_04d = "%04d";
-    const char *fmt_02d = "%02d";
 
     static string EMPTY = string();
 
@@ -17,38 +16,118 @@ namespace Project
         return EMPTY;
     }
 
-    void string::tokenize(char delim, std::function<void(string)> cb) const
+    bool string::readfrom(istream &istm, char delim)
     {
-        if (this->empty())
+        return istm.read_until(*this, delim);
+    }
+
+    void string::throw_implementationError(const char *msg)
+    {
+        throw ImplementationError(msg);
+    }
+
+    string_ref string_ref::substr(size_t from, size_t len) const
+    {
+        if (from > this->len)
         {
-            return;
+            from = this->len;
         }
+        if (len > this->len - from)
+        {
+            len = this->len - from;
+        }
+        return string_ref(this->ptr + from, len);
+    }
 
-        char pattern[2];
-        pattern[0] = delim;
-        pattern[1] = 0;
-        size_t cursor = 0;
-        while (true)
+    size_t string_ref::find(char ch, size_t pos) const
+    {
+        for (size_t i = pos; i < this->len; ++i)
         {
-            size_t index = this->find(pattern, cursor);
-            if (index == npos)
+            if (this->ptr[i] == ch)
             {
-                cb(this->substr(cursor));
-                return;
+                return i;
             }
-            cb(this->substr(cursor, index - cursor));
-            cursor = index + 1;
         }
+        return npos;
     }
 
-    bool string::readfrom(istream &istm, char delim)
+    // Splits at the first delim, returns false if there is none.
+    bool string_ref::split(char delim, string_ref &head, string_ref &tail) const
     {
-        return istm.read_until(*this, delim);
+        size_t index = this->find(delim);
+        if (index == npos)
+        {
+            return false;
+        }
+        // Copy first, head or tail may alias this
+        string_ref whole = *this;
+        head = whole.substr(0, index);
+        tail = whole.substr(index + 1);
+        return true;
     }
 
-    void string::throw_implementationError(const char *msg)
+    // Strict integer parse: optional sign followed by decimal digits only.
+    bool string_ref::to_int(int &value) const
     {
-        throw ImplementationError(msg);
+        char sign = this->at(0);
+        if (sign != '-' && sign != '+')
+        {
+            return this->to_digits(value);
+        }
+        if (!this->substr(1).to_digits(value))
+        {
+            return false;
+        }
+        if (sign == '-')
+        {
+            value = -value;
+        }
+        return true;
+    }
+
+    bool string_ref::to_digits(int &value) const
+    {
+        if (this->len == 0)
+        {
+            return false;
+        }
+
+        long long result = 0;
+        for (size_t i = 0; i < this->len; ++i)
+        {
+            char ch = this->ptr[i];
+            if (ch < '0' || ch > '9')
+            {
+                return false;
+            }
+            result = result * 10 + (ch - '0');
+            if (result > 0x7fffffffLL)
+            {
+                return false;
+            }
+        }
+        value = result;
+        return true;
+    }
+
+    bool string_ref::operator==(const string_ref &other) const
+    {
+        return this->len == other.len && memcmp(this->ptr, other.ptr, this->len) == 0;
+    }
+
+    string string_ref::str() const
+    {
+#ifdef ARDUINO
+        String result;
+        result.reserve(this->len);
+        for (size_t i = 0; i < this->len; ++i)
+        {
+            result += this->ptr[i];
+        }
+        return string(result);
+#else
+        return string(std::string(this->ptr, this->len));
+#endif
     }
 
 #ifdef ARDUINO
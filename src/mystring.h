@@ -1,6 +1,9 @@
 #ifndef mystring_h
 #define mystring_h
 
+#include <functional>
+
+#include "hash.h"
 #include "stream.h"
 
 #ifdef ARDUINO
@@ -16,8 +19,8 @@
 namespace Project
 {
     extern const char *endl;
-    extern const char *fmt_04d;
-    extern const char *fmt_02d;
+
+    class string_ref;
 
 #ifdef ARDUINO
 
@@ -46,9 +49,8 @@ namespace Project
         static string fmt(const char *fmt, Args... args)
         {
             char buf[40];
-            memset(buf, 0, 40);
-            sprintf(buf, fmt, args...);
-            if (buf[39] != 0)
+            int len = snprintf(buf, sizeof(buf), fmt, args...);
+            if (len < 0 || (size_t)len >= sizeof(buf))
             {
                 throw_implementationError("string::format buffer overflow");
             }
@@ -58,7 +60,8 @@ namespace Project
         int as_int() const;
         void rtrim();
         bool readfrom(istream &istm, char delim);
-        void tokenize(char delim, std::function<void(string)> cb) const;
+        template <typename F>
+        void tokenize(char delim, F cb) const;
         void replace_all(const string &from, const string &to) { this->replace(from, to); }
 
     protected:
@@ -91,9 +94,8 @@ namespace Project
         static string fmt(const char *fmt, Args... args)
         {
             char buf[40];
-            memset(buf, 0, 40);
-            sprintf(buf, fmt, args...);
-            if (buf[39] != 0)
+            int len = snprintf(buf, sizeof(buf), fmt, args...);
+            if (len < 0 || (size_t)len >= sizeof(buf))
             {
                 throw_implementationError("string::format buffer overflow");
             }
@@ -103,7 +105,8 @@ namespace Project
         int as_int() const;
         void rtrim();
         bool readfrom(istream &is, char delim);
-        void tokenize(char delim, std::function<void(string)> cb) const;
+        template <typename F>
+        void tokenize(char delim, F cb) const;
         void replace_all(const string &from, const string &to);
 
     protected:
@@ -111,24 +114,91 @@ namespace Project
     };
 
 #endif
+
+    // Non-owning view of a run of characters, e.g. part of a string.
+    //
+    // Slicing and parsing through a string_ref never allocates; the
+    // referenced characters must outlive the view.
+    class string_ref
+    {
+    public:
+        static const size_t npos = (size_t)-1;
+
+        string_ref() : ptr(""), len(0) {}
+        string_ref(const char *st) : ptr(st), len(strlen(st)) {}
+        string_ref(const char *st, size_t len) : ptr(st), len(len) {}
+#ifdef ARDUINO
+        string_ref(const String &st) : ptr(st.c_str()), len(st.length()) {}
+#else
+        string_ref(const std::string &st) : ptr(st.c_str()), len(st.length()) {}
+#endif
+
+        const char *data() const { return this->ptr; }
+        size_t length() const { return this->len; }
+        bool empty() const { return this->len == 0; }
+        char at(size_t pos) const { return pos < this->len ? this->ptr[pos] : 0; }
+
+        string_ref substr(size_t from, size_t len = npos) const;
+        size_t find(char ch, size_t pos = 0) const;
+        bool split(char delim, string_ref &head, string_ref &tail) const;
+        bool to_int(int &value) const;
+
+        // Decimal digits only, no sign, for fixed width fields like the
+        // month in 20240105
+        bool to_digits(int &value) const;
+
+        template <typename F>
+        void tokenize(char delim, F cb) const
+        {
+            if (this->empty())
+            {
+                return;
+            }
+
+            string_ref token, rest = *this;
+            while (rest.split(delim, token, rest))
+            {
+                cb(token);
+            }
+            cb(rest);
+        }
+
+        bool operator==(const string_ref &other) const;
+        bool operator!=(const string_ref &other) const { return !(*this == other); }
+
+        string str() const;
+
+    protected:
+        const char *ptr;
+        size_t len;
+    };
+
+    template <typename F>
+    void string::tokenize(char delim, F cb) const
+    {
+        string_ref(*this).tokenize(delim, cb);
+    }
 }
 
-// namespace std
-// {
-//     template <>
-//     struct hash<string>
-//     {
-//         size_t operator()(const string &str) const
-//         {
-// #ifdef ARDUINO
-//             // FIXME
-//             return 10;
-// #else
-//             // FIXME
-//             return 10;
-// #endif
-//         }
-//     };
-// }
+namespace std
+{
+    template <>
+    struct hash<Project::string_ref>
+    {
+        size_t operator()(const Project::string_ref &str) const
+        {
+            return Project::hash_bytes(str.data(), str.length());
+        }
+    };
+
+    template <>
+    struct hash<Project::string>
+    {
+        size_t operator()(const Project::string &str) const
+        {
+            return Project::hash_bytes(str.c_str(), str.length());
+        }
+    };
+}
 
 #endif
\ No newline at end of file
@@ -5,6 +5,8 @@
 #include "datecalc.h"
 #include "datetime.h"
 
+#include <stdexcept>
+
 namespace Project
 {
     Time::Time()
@@ -14,30 +16,21 @@ namespace Project
         this->second = 0;
     }
 
-    Time::Time(const string &time)
+    Time::Time(const string_ref &time)
     {
-        for (;;)
+        int hour, minute, second;
+        if (time.length() == 6 &&
+            time.substr(0, 2).to_digits(hour) &&
+            time.substr(2, 2).to_digits(minute) &&
+            time.substr(4, 2).to_digits(second))
         {
-            try
-            {
-                if (time.length() != 6)
-                {
-                    break;
-                }
-                this->hour = time.substr(9, 2).as_int();
-                this->minute = time.substr(11, 2).as_int();
-                this->second = time.substr(13, 2).as_int();
-                this->validate();
-                return;
-            }
-            catch (std::invalid_argument const &e)
-            {
-            }
-            catch (std::out_of_range const &e)
-            {
-            }
+            this->hour = hour;
+            this->minute = minute;
+            this->second = second;
+            this->validate();
+            return;
         }
-        throw ValueError(string("Bad time: \"") + time + "\"");
+        throw ValueError(string("Bad time: \"") + time.str() + "\"");
     }
 
     Time::Time(unsigned hour, unsigned minute, unsigned second)
@@ -128,10 +121,10 @@ namespace Project
 
     void Time::str(ostream &out) const
     {
-        this->hour < 24 ? out << string::fmt(fmt_02d, this->hour) : out << "??";
-        this->minute < 60 ? out << string::fmt(fmt_02d, this->minute) : out << "??";
+        this->hour < 24 ? out << zero_pad(this->hour, 2) : out << "??";
+        this->minute < 60 ? out << zero_pad(this->minute, 2) : out << "??";
         ;
-        this->second < 60 ? out << string::fmt(fmt_02d, this->second) : out << "??";
+        this->second < 60 ? out << zero_pad(this->second, 2) : out << "??";
         ;
     }
 
@@ -10,7 +10,7 @@ namespace Project
     {
     public:
         Time();
-        Time(const string &time);
+        Time(const string_ref &time);
         Time(unsigned hour, unsigned minute, unsigned second);
         Time(const DateTime &datetime);
 
@@ -0,0 +1,57 @@
+#include "range_index.h"
+
+#include <algorithm>
+
+namespace Project
+{
+    void RangeIndex::clear()
+    {
+        this->items.clear();
+        this->longest = 0;
+    }
+
+    void RangeIndex::reserve(size_t n)
+    {
+        this->items.reserve(n);
+    }
+
+    void RangeIndex::add(seconds_t start, seconds_t end, unsigned slot)
+    {
+        // Events ending before they start are treated as instants
+        this->items.push_back(item{start, std::max(start, end), slot});
+    }
+
+    void RangeIndex::build()
+    {
+        // Stable, so items starting together keep their payload order
+        std::stable_sort(this->items.begin(), this->items.end(),
+                         [](const item &a, const item &b)
+                         { return a.start < b.start; });
+
+        this->longest = 0;
+        for (const item &i : this->items)
+        {
+            this->longest = std::max(this->longest, i.end - i.start);
+        }
+    }
+
+    size_t RangeIndex::query(seconds_t begin, seconds_t end, std::vector<unsigned> &slots) const
+    {
+        // Nothing starting earlier than this can still be running at begin
+        seconds_t earliest = begin - this->longest;
+        auto first = std::lower_bound(this->items.begin(), this->items.end(), earliest,
+                                      [](const item &i, seconds_t start)
+                                      { return i.start < start; });
+
+        size_t count = 0;
+        for (auto i = first; i != this->items.end() && i->start < end; ++i)
+        {
+            if (i->end >= begin)
+            {
+                slots.push_back(i->slot);
+                ++count;
+            }
+        }
+        return count;
+    }
+}
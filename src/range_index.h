@@ -0,0 +1,51 @@
+#ifndef range_index_h
+#define range_index_h
+
+#include <vector>
+
+#include "types.h"
+
+namespace Project
+{
+    // Finds the events that overlap an arbitrary time window, e.g. the
+    // days of a page.
+    //
+    // Items are kept sorted by start time, along with the longest
+    // duration of any item. Anything overlapping [begin, end) then
+    // starts in [begin - longest, end), so a query is a binary search
+    // plus a scan of that range.
+    class RangeIndex
+    {
+    public:
+        struct item
+        {
+            seconds_t start;
+            seconds_t end;
+            unsigned slot;
+        };
+
+        RangeIndex() : longest(0) {}
+
+        void clear();
+        void reserve(size_t n);
+
+        // Bulk load: add() everything, then build() once before querying.
+        void add(seconds_t start, seconds_t end, unsigned slot);
+        void build();
+
+        // Appends the slots of the items that start before end and don't
+        // end before begin, in start time order. An item ending exactly at
+        // begin counts, like an event ending at midnight still showing on
+        // that day. Returns the number of slots added.
+        size_t query(seconds_t begin, seconds_t end, std::vector<unsigned> &slots) const;
+
+        size_t size() const { return this->items.size(); }
+        const item &operator[](size_t i) const { return this->items[i]; }
+
+    protected:
+        std::vector<item> items;
+        seconds_t longest;
+    };
+}
+
+#endif
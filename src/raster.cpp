@@ -0,0 +1,270 @@
+#include "raster.h"
+
+#include <string.h>
+
+namespace Project
+{
+    static inline bool is_black(uint8_t color)
+    {
+        return (color & 7) < 4;
+    }
+
+    Raster::Raster(uint8_t *frame, int panel_width, int panel_height, int rotation, Format format)
+        : frame(frame), panel_width(panel_width), panel_height(panel_height), rotation(rotation & 3),
+          format(format), clip_y0(0), clip_y1(panel_height)
+    {
+    }
+
+    void Raster::setClip(int y0, int y1)
+    {
+        this->clip_y0 = y0 < 0 ? 0 : y0;
+        this->clip_y1 = y1 > this->panel_height ? this->panel_height : y1;
+    }
+
+    Rect Raster::toPanel(const Rect &r) const
+    {
+        switch (this->rotation)
+        {
+        case 1:
+            return Rotation<1>::toPanel(r, this->panel_width, this->panel_height);
+        case 2:
+            return Rotation<2>::toPanel(r, this->panel_width, this->panel_height);
+        case 3:
+            return Rotation<3>::toPanel(r, this->panel_width, this->panel_height);
+        default:
+            return r;
+        }
+    }
+
+    // True if nothing in rect can be drawn
+    bool Raster::clipped(const Rect &rect) const
+    {
+        return this->panelClipped(this->toPanel(rect));
+    }
+
+    void Raster::pixel(int x, int y, uint8_t color)
+    {
+        Rect panel = this->toPanel(Rect{x, y, 1, 1});
+        int px = panel.x, py = panel.y;
+        if (px < 0 || px >= this->panel_width || py < this->clip_y0 || py >= this->clip_y1)
+        {
+            return;
+        }
+
+        if (this->format == MONO)
+        {
+            uint8_t &byte = this->frame[py * (this->panel_width / 8) + px / 8];
+            byte = is_black(color) ? byte | (1 << (px & 7)) : byte & ~(1 << (px & 7));
+            return;
+        }
+
+        uint8_t &byte = this->frame[py * (this->panel_width / 2) + px / 2];
+        color &= 7;
+        byte = px & 1 ? (byte & 0xf0) | color : (byte & 0x0f) | (color << 4);
+    }
+
+    void Raster::fillRect(int x, int y, int w, int h, uint8_t color)
+    {
+        if (w <= 0 || h <= 0)
+        {
+            return;
+        }
+        Rect panel = this->toPanel(Rect{x, y, w, h});
+        this->fillPanel(panel.x, panel.y, panel.w, panel.h, color);
+    }
+
+    void Raster::fillRoundRect(int x, int y, int w, int h, int radius, uint8_t color)
+    {
+        round_rect_spans(x, y, w, h, radius, [this, color](int sx, int sy, int sw, int sh)
+                         { this->fillRect(sx, sy, sw, sh, color); });
+    }
+
+    // Lines of more than one pixel grow down / right, like drawThickLine
+    void Raster::hline(int x, int y, int w, uint8_t color, int thickness)
+    {
+        this->fillRect(x, y - (thickness - 1) / 2, w, thickness, color);
+    }
+
+    void Raster::vline(int x, int y, int h, uint8_t color, int thickness)
+    {
+        this->fillRect(x - (thickness - 1) / 2, y, thickness, h, color);
+    }
+
+    void Raster::rect(int x, int y, int w, int h, uint8_t color)
+    {
+        if (w <= 0 || h <= 0)
+        {
+            return;
+        }
+        this->fillRect(x, y, w, 1, color);
+        this->fillRect(x, y + h - 1, w, 1, color);
+        this->fillRect(x, y + 1, 1, h - 2, color);
+        this->fillRect(x + w - 1, y + 1, 1, h - 2, color);
+    }
+
+    void Raster::fillPanel(int x, int y, int w, int h, uint8_t color)
+    {
+        // Clip to the panel
+        if (x < 0)
+        {
+            w += x;
+            x = 0;
+        }
+        if (y < this->clip_y0)
+        {
+            h -= this->clip_y0 - y;
+            y = this->clip_y0;
+        }
+        if (x + w > this->panel_width)
+            w = this->panel_width - x;
+        if (y + h > this->clip_y1)
+            h = this->clip_y1 - y;
+        if (w <= 0 || h <= 0)
+        {
+            return;
+        }
+        if (this->format == MONO)
+        {
+            this->fillMono(x, y, w, h, is_black(color));
+            return;
+        }
+
+        color &= 7;
+        const uint8_t both = (color << 4) | color;
+        const int stride = this->panel_width / 2;
+
+        // Odd pixel at the start, whole bytes, even pixel at the end
+        bool head = x & 1;
+        int first_byte = (x + 1) / 2;
+        int last_x = x + w;
+        bool tail = last_x & 1;
+        int bytes = last_x / 2 - first_byte;
+
+        uint8_t *row = this->frame + y * stride;
+        for (int i = 0; i < h; ++i, row += stride)
+        {
+            if (head)
+            {
+                row[x / 2] = (row[x / 2] & 0xf0) | color;
+            }
+            if (bytes > 0)
+            {
+                memset(row + first_byte, both, bytes);
+            }
+            if (tail)
+            {
+                row[last_x / 2] = (row[last_x / 2] & 0x0f) | (color << 4);
+            }
+        }
+    }
+
+    void Raster::blitMask(int px, int py, int bytes, int rows, const uint8_t *mask, int stride, uint8_t color)
+    {
+        int bx = px / 2;
+        if (bx < 0)
+        {
+            mask -= bx;
+            bytes += bx;
+            bx = 0;
+        }
+        if (py < this->clip_y0)
+        {
+            mask += (this->clip_y0 - py) * stride;
+            rows -= this->clip_y0 - py;
+            py = this->clip_y0;
+        }
+        if (bx + bytes > this->panel_width / 2)
+            bytes = this->panel_width / 2 - bx;
+        if (py + rows > this->clip_y1)
+            rows = this->clip_y1 - py;
+        if (bytes <= 0 || rows <= 0)
+        {
+            return;
+        }
+
+        uint8_t pattern = (color & 7) * 0x11;
+        uint8_t *line = this->frame + py * (this->panel_width / 2) + bx;
+        for (int row = 0; row < rows; ++row)
+        {
+            for (int i = 0; i < bytes; ++i)
+            {
+                line[i] = (line[i] & ~mask[i]) | (pattern & mask[i]);
+            }
+            line += this->panel_width / 2;
+            mask += stride;
+        }
+    }
+
+    // Already clipped
+    void Raster::fillMono(int x, int y, int w, int h, bool black)
+    {
+        const int stride = this->panel_width / 8;
+
+        // Partial byte at either end, whole bytes between
+        int first_byte = x / 8;
+        int last_byte = (x + w - 1) / 8;
+        uint8_t head = 0xff << (x & 7);
+        uint8_t tail = 0xff >> (7 - ((x + w - 1) & 7));
+        if (first_byte == last_byte)
+        {
+            head &= tail;
+        }
+
+        uint8_t *row = this->frame + y * stride;
+        for (int i = 0; i < h; ++i, row += stride)
+        {
+            row[first_byte] = black ? row[first_byte] | head : row[first_byte] & ~head;
+            if (last_byte > first_byte)
+            {
+                if (last_byte > first_byte + 1)
+                {
+                    memset(row + first_byte + 1, black ? 0xff : 0, last_byte - first_byte - 1);
+                }
+                row[last_byte] = black ? row[last_byte] | tail : row[last_byte] & ~tail;
+            }
+        }
+    }
+
+    void Raster::blitBits(int px, int py, int bytes, int rows, const uint8_t *bits, int stride, uint8_t color)
+    {
+        if (py < this->clip_y0)
+        {
+            bits += (this->clip_y0 - py) * stride;
+            rows -= this->clip_y0 - py;
+            py = this->clip_y0;
+        }
+        if (py + rows > this->clip_y1)
+            rows = this->clip_y1 - py;
+        if (bytes <= 0 || rows <= 0)
+        {
+            return;
+        }
+
+        // Each source byte straddles two frame bytes unless px is a
+        // multiple of 8
+        const int frame_stride = this->panel_width / 8;
+        const int bx = px >> 3;
+        const int shift = px & 7;
+        const bool black = is_black(color);
+        uint8_t *line = this->frame + py * frame_stride;
+        for (int row = 0; row < rows; ++row)
+        {
+            for (int i = 0; i < bytes; ++i)
+            {
+                int lo = bx + i, hi = lo + 1;
+                uint8_t lo_bits = bits[i] << shift;
+                uint8_t hi_bits = shift ? bits[i] >> (8 - shift) : 0;
+                if (lo >= 0 && lo < frame_stride)
+                {
+                    line[lo] = black ? line[lo] | lo_bits : line[lo] & ~lo_bits;
+                }
+                if (hi_bits && hi >= 0 && hi < frame_stride)
+                {
+                    line[hi] = black ? line[hi] | hi_bits : line[hi] & ~hi_bits;
+                }
+            }
+            line += frame_stride;
+            bits += stride;
+        }
+    }
+}
@@ -0,0 +1,136 @@
+#ifndef raster_h
+#define raster_h
+
+#include <stdint.h>
+
+#include "rect.h"
+
+namespace Project
+{
+    // Logical to panel mapping for each rotation, the same as
+    // Graphics::writePixel, for a panel pw x ph. With the rotation as a
+    // template argument the mapping is resolved at compile time, and 0
+    // and 180 degrees keep logical rows as panel rows.
+    template <int R>
+    struct Rotation;
+
+    template <>
+    struct Rotation<0>
+    {
+        static Rect toPanel(const Rect &r, int, int) { return r; }
+    };
+
+    template <>
+    struct Rotation<1>
+    {
+        static Rect toPanel(const Rect &r, int pw, int) { return Rect{pw - r.y - r.h, r.x, r.h, r.w}; }
+    };
+
+    template <>
+    struct Rotation<2>
+    {
+        static Rect toPanel(const Rect &r, int pw, int ph) { return Rect{pw - r.x - r.w, ph - r.y - r.h, r.w, r.h}; }
+    };
+
+    template <>
+    struct Rotation<3>
+    {
+        static Rect toPanel(const Rect &r, int, int ph) { return Rect{r.y, ph - r.x - r.w, r.h, r.w}; }
+    };
+
+    // Calls span(x, y, w, h) for the spans making up a filled rectangle
+    // with quarter circle corners, one per row in the corners
+    template <typename F>
+    void round_rect_spans(int x, int y, int w, int h, int radius, F span)
+    {
+        int max_radius = (w < h ? w : h) / 2;
+        if (radius > max_radius)
+        {
+            radius = max_radius;
+        }
+
+        span(x, y + radius, w, h - 2 * radius);
+        for (int row = 0; row < radius; ++row)
+        {
+            // Inset where the circle crosses the middle of this row
+            int dy = radius - row;
+            int dx = 0;
+            while ((dx + 1) * (dx + 1) + dy * dy <= radius * radius)
+            {
+                ++dx;
+            }
+            int inset = radius - dx;
+            span(x + inset, y + row, w - 2 * inset, 1);
+            span(x + inset, y + h - 1 - row, w - 2 * inset, 1);
+        }
+    }
+
+    // Axis aligned drawing straight into an Inkplate framebuffer.
+    //
+    // The 3-bit framebuffer holds two pixels per byte, even x in the
+    // high nibble; the 1-bit one eight pixels per byte, lowest bit first,
+    // set for black. Both are in panel (unrotated) coordinates. Callers
+    // use the same rotated coordinates as Adafruit GFX; as rectangles
+    // stay rectangles under rotation, each call is mapped to the panel
+    // once rather than per pixel.
+    //
+    // Colors are always 3-bit, 0 black to 7 white. In 1-bit frames 0-3
+    // are black and 4-7 white.
+    class Raster
+    {
+    public:
+        enum Format
+        {
+            GRAY3,
+            MONO
+        };
+
+        Raster(uint8_t *frame, int panel_width, int panel_height, int rotation, Format format = GRAY3);
+
+        int width() const { return this->rotation & 1 ? this->panel_height : this->panel_width; }
+        int height() const { return this->rotation & 1 ? this->panel_width : this->panel_height; }
+        int panelWidth() const { return this->panel_width; }
+        int panelHeight() const { return this->panel_height; }
+        int getRotation() const { return this->rotation; }
+        Format getFormat() const { return this->format; }
+
+        // Only panel rows [y0, y1) are written, so several Rasters can
+        // share a frame as long as their row ranges don't overlap.
+        void setClip(int y0, int y1);
+        bool clipped(const Rect &rect) const;
+        bool panelClipped(const Rect &panel) const { return panel.y >= this->clip_y1 || panel.y + panel.h <= this->clip_y0; }
+        Rect toPanel(const Rect &rect) const;
+
+        void pixel(int x, int y, uint8_t color);
+        void fillRect(int x, int y, int w, int h, uint8_t color);
+        void fillRoundRect(int x, int y, int w, int h, int radius, uint8_t color);
+        void hline(int x, int y, int w, uint8_t color, int thickness = 1);
+        void vline(int x, int y, int h, uint8_t color, int thickness = 1);
+        void rect(int x, int y, int w, int h, uint8_t color);
+
+        // Panel coordinates, clipped
+        void fillPanel(int x, int y, int w, int h, uint8_t color);
+
+        // Panel coordinates, 3-bit frames: rows of mask bytes laid over
+        // the frame from the even column px, each byte selecting which of
+        // the two pixels below it take color
+        void blitMask(int px, int py, int bytes, int rows, const uint8_t *mask, int stride, uint8_t color);
+
+        // Panel coordinates, 1-bit frames: rows of bits, lowest first,
+        // laid over the frame from column px, set bits taking color
+        void blitBits(int px, int py, int bytes, int rows, const uint8_t *bits, int stride, uint8_t color);
+
+    protected:
+        void fillMono(int x, int y, int w, int h, bool black);
+
+        uint8_t *frame;
+        int panel_width;
+        int panel_height;
+        int rotation;
+        Format format;
+        int clip_y0;
+        int clip_y1;
+    };
+}
+
+#endif
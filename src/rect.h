@@ -0,0 +1,15 @@
+#ifndef rect_h
+#define rect_h
+
+namespace Project
+{
+    struct Rect
+    {
+        int x;
+        int y;
+        int w;
+        int h;
+    };
+}
+
+#endif
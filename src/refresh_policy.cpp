@@ -0,0 +1,184 @@
+#include "refresh_policy.h"
+
+namespace Project
+{
+    // Starting guesses for a 6" panel, replaced as refreshes are timed
+    static const float PARTIAL_BASE_MS = 350;
+    static const float PARTIAL_AREA_MS = 200;
+    static const float FULL_MONO_MS = 1100;
+    static const float FULL_GRAY_MS = 1700;
+
+    // How fast old timings fade, per refresh
+    static const float FIT_DECAY = 0.9f;
+    static const float FULL_SMOOTHING = 0.25f;
+
+    RefreshPolicy::RefreshPolicy(const Limits &limits)
+        : limits(limits), partial_count(0), partial_area(0), last_clean(0),
+          fit_weight(0), fit_x(0), fit_y(0), fit_xx(0), fit_xy(0),
+          full_ms{FULL_MONO_MS, FULL_GRAY_MS}, refresh_stats{}
+    {
+    }
+
+    const char *RefreshPolicy::cleanDue(unsigned long now) const
+    {
+        if (this->partial_count >= this->limits.max_partials)
+        {
+            return "partial update limit";
+        }
+        if (this->partial_area >= this->limits.max_partial_area)
+        {
+            return "partial area limit";
+        }
+        if (now - this->last_clean >= this->limits.clean_interval_ms)
+        {
+            return "clean refresh interval";
+        }
+        return nullptr;
+    }
+
+    unsigned long RefreshPolicy::cleanIn(unsigned long now) const
+    {
+        if (this->cleanDue(now) != nullptr)
+        {
+            return 0;
+        }
+        return this->limits.clean_interval_ms - (now - this->last_clean);
+    }
+
+    unsigned long RefreshPolicy::estimate(Refresh refresh, float dirty_fraction) const
+    {
+        switch (refresh)
+        {
+        case PARTIAL:
+        {
+            // The guesses always count as two updates, an empty one and a
+            // full screen one. They keep the slope sensible when recent
+            // updates were all about the same size, e.g. clock ticks.
+            float w = this->fit_weight + 2;
+            float x = this->fit_x + 1;
+            float y = this->fit_y + 2 * PARTIAL_BASE_MS + PARTIAL_AREA_MS;
+            float xx = this->fit_xx + 1;
+            float xy = this->fit_xy + PARTIAL_BASE_MS + PARTIAL_AREA_MS;
+
+            float slope = (w * xy - x * y) / (w * xx - x * x);
+            if (slope < 0)
+            {
+                slope = 0;
+            }
+            float base = (y - slope * x) / w;
+            float ms = base + slope * dirty_fraction;
+            return ms > 0 ? (unsigned long)ms : 0;
+        }
+        case FULL_MONO:
+            return (unsigned long)this->full_ms[0];
+        case FULL_GRAY:
+            return (unsigned long)this->full_ms[1];
+        default:
+            return 0;
+        }
+    }
+
+    // A partial update's share of the clean refresh it brings closer,
+    // by whichever limit it uses up faster
+    unsigned long RefreshPolicy::ghostCost(float dirty_fraction) const
+    {
+        float by_count = 1.0f / this->limits.max_partials;
+        float by_area = dirty_fraction / this->limits.max_partial_area;
+        return (unsigned long)(this->estimate(FULL_GRAY, 1) * (by_count > by_area ? by_count : by_area));
+    }
+
+    RefreshPolicy::Decision RefreshPolicy::decide(bool mono, float dirty_fraction, unsigned long budget_ms) const
+    {
+        if (dirty_fraction <= 0)
+        {
+            return Decision{NONE, "unchanged", 0, 0};
+        }
+
+        if (!mono)
+        {
+            unsigned long gray = this->estimate(FULL_GRAY, dirty_fraction);
+            if (gray > budget_ms)
+            {
+                return Decision{NONE, "grayscale refresh over budget", 0, gray};
+            }
+            return Decision{FULL_GRAY, "grayscale mode", gray, 0};
+        }
+
+        unsigned long full = this->estimate(FULL_MONO, dirty_fraction);
+        bool partial_allowed = this->partial_count < this->limits.max_partials &&
+                               this->partial_area + dirty_fraction <= this->limits.max_partial_area;
+        if (!partial_allowed)
+        {
+            if (full > budget_ms)
+            {
+                return Decision{NONE, "ghosting limit, full refresh over budget", 0, full};
+            }
+            return Decision{FULL_MONO, "ghosting limit", full, 0};
+        }
+
+        // What the partial update is charged includes its ghosting, what
+        // it takes on the panel doesn't
+        unsigned long partial = this->estimate(PARTIAL, dirty_fraction);
+        unsigned long partial_cost = partial + this->ghostCost(dirty_fraction);
+        if (partial_cost <= full || full > budget_ms)
+        {
+            if (partial > budget_ms)
+            {
+                return Decision{NONE, "partial update over budget", 0, partial};
+            }
+            return Decision{PARTIAL, partial_cost <= full ? "cheaper than full" : "full refresh over budget",
+                            partial, full};
+        }
+        return Decision{FULL_MONO, "cheaper than partial", full, partial_cost};
+    }
+
+    void RefreshPolicy::record(Refresh refresh, float dirty_fraction, unsigned long ms, unsigned long now)
+    {
+        if (refresh >= REFRESH_KINDS)
+        {
+            return;
+        }
+        Stats &stats = this->refresh_stats[refresh];
+        ++stats.count;
+        stats.total_ms += ms;
+
+        if (refresh == PARTIAL)
+        {
+            ++this->partial_count;
+            this->partial_area += dirty_fraction;
+
+            float x = dirty_fraction, y = ms;
+            this->fit_weight = this->fit_weight * FIT_DECAY + 1;
+            this->fit_x = this->fit_x * FIT_DECAY + x;
+            this->fit_y = this->fit_y * FIT_DECAY + y;
+            this->fit_xx = this->fit_xx * FIT_DECAY + x * x;
+            this->fit_xy = this->fit_xy * FIT_DECAY + x * y;
+            return;
+        }
+
+        float &average = this->full_ms[refresh == FULL_MONO ? 0 : 1];
+        average += (ms - average) * FULL_SMOOTHING;
+
+        this->partial_count = 0;
+        this->partial_area = 0;
+        if (refresh == FULL_GRAY)
+        {
+            this->last_clean = now;
+        }
+    }
+
+    const char *RefreshPolicy::name(Refresh refresh)
+    {
+        switch (refresh)
+        {
+        case PARTIAL:
+            return "1-bit partial";
+        case FULL_MONO:
+            return "1-bit full";
+        case FULL_GRAY:
+            return "3-bit full";
+        default:
+            return "none";
+        }
+    }
+}
@@ -0,0 +1,111 @@
+#ifndef refresh_policy_h
+#define refresh_policy_h
+
+namespace Project
+{
+    // Decides how each frame goes to the panel.
+    //
+    // Partial updates are fast but leave ghosting behind, in proportion
+    // to how many there were and how much of the panel they covered.
+    // A full refresh clears it, and a grayscale one also resets the
+    // time since the last clean refresh. The policy keeps count of both
+    // and an estimate of how long each kind of refresh takes, learnt
+    // from the ones done so far, and picks the cheapest refresh that
+    // fits the time allowed. A partial update is charged its share of
+    // the clean refresh it brings closer.
+    //
+    // It only does arithmetic, times are passed in, so it runs the same
+    // on the host.
+    class RefreshPolicy
+    {
+    public:
+        enum Refresh
+        {
+            PARTIAL,
+            FULL_MONO,
+            FULL_GRAY,
+            REFRESH_KINDS,
+            NONE = REFRESH_KINDS
+        };
+
+        struct Limits
+        {
+            // A full refresh is forced after this many partial updates,
+            // or once their dirty fractions add up to this many screens
+            unsigned max_partials;
+            float max_partial_area;
+            // A grayscale refresh at least this often
+            unsigned long clean_interval_ms;
+        };
+
+        struct Decision
+        {
+            Refresh refresh;
+            const char *reason;
+            // Expected time on the panel, and for the best alternative
+            // that was turned down, 0 if there was none
+            unsigned long estimate_ms;
+            unsigned long alternative_ms;
+        };
+
+        struct Stats
+        {
+            unsigned count;
+            unsigned long total_ms;
+        };
+
+        static const unsigned long UNLIMITED = (unsigned long)-1;
+
+        RefreshPolicy(const Limits &limits);
+
+        // Why the next frame should be a clean grayscale refresh, or
+        // nullptr if one isn't due
+        const char *cleanDue(unsigned long now) const;
+
+        // How long until cleanDue() would say so, 0 if it already does.
+        // Only the interval runs out with time, the other limits wait on
+        // more partial updates.
+        unsigned long cleanIn(unsigned long now) const;
+
+        // How to push a frame with dirty_fraction of the panel changed.
+        // In mono mode partial updates are possible, otherwise only a
+        // full refresh is. Refreshes expected to take longer than
+        // budget_ms are put off.
+        Decision decide(bool mono, float dirty_fraction, unsigned long budget_ms = UNLIMITED) const;
+
+        // A refresh was done, taking ms
+        void record(Refresh refresh, float dirty_fraction, unsigned long ms, unsigned long now);
+
+        // Expected panel time of a refresh
+        unsigned long estimate(Refresh refresh, float dirty_fraction) const;
+
+        unsigned partials() const { return this->partial_count; }
+        float partialArea() const { return this->partial_area; }
+        const Stats &stats(Refresh refresh) const { return this->refresh_stats[refresh]; }
+
+        static const char *name(Refresh refresh);
+
+    protected:
+        unsigned long ghostCost(float dirty_fraction) const;
+
+        Limits limits;
+        unsigned partial_count;
+        float partial_area;
+        unsigned long last_clean;
+
+        // Partial update time as a line over the dirty fraction, fitted
+        // to recent updates by least squares with older ones decaying
+        float fit_weight;
+        float fit_x;
+        float fit_y;
+        float fit_xx;
+        float fit_xy;
+
+        // Moving average of each kind of full refresh
+        float full_ms[2];
+
+        Stats refresh_stats[REFRESH_KINDS];
+    };
+}
+
+#endif
@@ -0,0 +1,151 @@
+#include "rle.h"
+
+#include <string.h>
+
+namespace Project
+{
+    namespace
+    {
+        // Batches output so the sink sees few, larger writes
+        class chunk_writer
+        {
+        public:
+            chunk_writer(const rle_sink_t &sink) : sink(sink), used(0), total(0), ok(true) {}
+
+            void put(const uint8_t *data, size_t len)
+            {
+                if (this->used + len > sizeof(this->buffer))
+                {
+                    this->flush();
+                }
+                memcpy(this->buffer + this->used, data, len);
+                this->used += len;
+                this->total += len;
+            }
+
+            void flush()
+            {
+                if (this->used > 0 && this->ok)
+                {
+                    this->ok = this->sink(this->buffer, this->used);
+                }
+                this->used = 0;
+            }
+
+            const rle_sink_t &sink;
+            uint8_t buffer[256];
+            size_t used;
+            size_t total;
+            bool ok;
+        };
+    }
+
+    size_t rle_encode(const uint8_t *src, size_t len, const rle_sink_t &sink)
+    {
+        chunk_writer out(sink);
+        size_t i = 0;
+        while (i < len)
+        {
+            // Length of the run starting here
+            size_t run = 1;
+            while (i + run < len && run < 128 && src[i + run] == src[i])
+            {
+                ++run;
+            }
+            if (run >= 3)
+            {
+                uint8_t packet[2] = {(uint8_t)(257 - run), src[i]};
+                out.put(packet, 2);
+                i += run;
+                continue;
+            }
+
+            // Literals up to the next run of three or more
+            size_t literal = 0;
+            while (i + literal < len && literal < 128)
+            {
+                if (i + literal + 2 < len && src[i + literal] == src[i + literal + 1] &&
+                    src[i + literal] == src[i + literal + 2])
+                {
+                    break;
+                }
+                ++literal;
+            }
+            uint8_t header = literal - 1;
+            out.put(&header, 1);
+            out.put(src + i, literal);
+            i += literal;
+        }
+        out.flush();
+        return out.ok ? out.total : 0;
+    }
+
+    RleDecoder::RleDecoder(uint8_t *dst, size_t size)
+    {
+        this->reset(dst, size);
+    }
+
+    void RleDecoder::reset(uint8_t *dst, size_t size)
+    {
+        this->dst = dst;
+        this->size = size;
+        this->pos = 0;
+        this->header = -1;
+        this->pending = 0;
+        this->failed = false;
+    }
+
+    bool RleDecoder::feed(const uint8_t *data, size_t len)
+    {
+        // Anything left over once the buffer is full would overrun it
+        if (this->consume(data, len) < len)
+        {
+            this->failed = true;
+        }
+        return !this->failed;
+    }
+
+    size_t RleDecoder::consume(const uint8_t *data, size_t len)
+    {
+        size_t i = 0;
+        while (i < len && !this->failed)
+        {
+            if (this->pending == 0)
+            {
+                if (this->pos == this->size)
+                {
+                    break;
+                }
+
+                // Header byte
+                uint8_t n = data[i++];
+                if (n == 128)
+                {
+                    this->failed = true;
+                    break;
+                }
+                this->header = n;
+                this->pending = n < 128 ? n + 1 : 257 - n;
+                if (this->pos + this->pending > this->size)
+                {
+                    this->failed = true;
+                }
+            }
+            else if (this->header < 128)
+            {
+                size_t copy = len - i < this->pending ? len - i : this->pending;
+                memcpy(this->dst + this->pos, data + i, copy);
+                this->pos += copy;
+                this->pending -= copy;
+                i += copy;
+            }
+            else
+            {
+                memset(this->dst + this->pos, data[i++], this->pending);
+                this->pos += this->pending;
+                this->pending = 0;
+            }
+        }
+        return i;
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef rle_h
+#define rle_h
+
+#include <functional>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Project
+{
+    // PackBits run length coding. Each header byte n is followed by n + 1
+    // literal bytes if n < 128, or by one byte to repeat 257 - n times if
+    // n > 128; 128 is not used. A calendar frame is mostly runs of white,
+    // so it packs to a few percent of its size.
+
+    using rle_sink_t = std::function<bool(const uint8_t *data, size_t len)>;
+
+    // Packs src and hands the result to sink in small chunks. Returns
+    // the packed size, or 0 if sink returned false.
+    size_t rle_encode(const uint8_t *src, size_t len, const rle_sink_t &sink);
+
+    // Unpacks into a fixed buffer as packed data arrives, in pieces of
+    // any size, so only the output has to be in memory.
+    class RleDecoder
+    {
+    public:
+        RleDecoder(uint8_t *dst, size_t size);
+
+        // Start again with another buffer
+        void reset(uint8_t *dst, size_t size);
+
+        // False once the data is malformed or would overrun the buffer
+        bool feed(const uint8_t *data, size_t len);
+
+        // Like feed(), but stops once the buffer is full and returns how
+        // much of data was used, for packed data followed by something else
+        size_t consume(const uint8_t *data, size_t len);
+
+        bool done() const { return !this->failed && this->pos == this->size && this->pending == 0; }
+        bool error() const { return this->failed; }
+        size_t written() const { return this->pos; }
+
+    protected:
+        uint8_t *dst;
+        size_t size;
+        size_t pos;
+
+        // What the next input bytes are: a header, literals still to
+        // copy, or the byte of a run
+        int header;
+        size_t pending;
+        bool failed;
+    };
+}
+
+#endif
@@ -0,0 +1,100 @@
+#include "snapshot.h"
+
+#include <string.h>
+
+#include "hash.h"
+
+namespace Project
+{
+    namespace
+    {
+        const uint32_t SNAPSHOT_MAGIC = 0x4b534352; // "RCSK"
+        const uint8_t SNAPSHOT_VERSION = 1;
+
+        // Stored little endian, as the ESP32 is
+        struct header
+        {
+            uint32_t magic;
+            uint8_t version;
+            uint8_t mode;
+            uint8_t rotation;
+            uint8_t reserved;
+            uint16_t width;
+            uint16_t height;
+            uint32_t size;
+            uint64_t hash;
+        };
+
+        bool read_exact(const snapshot_source_t &source, uint8_t *buffer, size_t len)
+        {
+            while (len > 0)
+            {
+                size_t got = source(buffer, len);
+                if (got == 0)
+                {
+                    return false;
+                }
+                buffer += got;
+                len -= got;
+            }
+            return true;
+        }
+    }
+
+    size_t write_snapshot(snapshot_info &info, const uint8_t *frame, const rle_sink_t &sink)
+    {
+        info.hash = hash_bytes((const char *)frame, info.size);
+
+        header h = {};
+        h.magic = SNAPSHOT_MAGIC;
+        h.version = SNAPSHOT_VERSION;
+        h.mode = info.mode;
+        h.rotation = info.rotation;
+        h.width = info.width;
+        h.height = info.height;
+        h.size = info.size;
+        h.hash = info.hash;
+
+        if (!sink((const uint8_t *)&h, sizeof(h)))
+        {
+            return 0;
+        }
+        size_t packed = rle_encode(frame, info.size, sink);
+        return packed > 0 ? sizeof(h) + packed : 0;
+    }
+
+    bool read_snapshot_info(snapshot_info &info, const snapshot_source_t &source)
+    {
+        header h;
+        if (!read_exact(source, (uint8_t *)&h, sizeof(h)))
+        {
+            return false;
+        }
+        if (h.magic != SNAPSHOT_MAGIC || h.version != SNAPSHOT_VERSION)
+        {
+            return false;
+        }
+        info.mode = h.mode;
+        info.rotation = h.rotation;
+        info.width = h.width;
+        info.height = h.height;
+        info.size = h.size;
+        info.hash = h.hash;
+        return true;
+    }
+
+    bool read_snapshot_frame(const snapshot_info &info, uint8_t *frame, const snapshot_source_t &source)
+    {
+        RleDecoder decoder(frame, info.size);
+        uint8_t buffer[256];
+        while (!decoder.done())
+        {
+            size_t got = source(buffer, sizeof(buffer));
+            if (got == 0 || !decoder.feed(buffer, got))
+            {
+                return false;
+            }
+        }
+        return hash_bytes((const char *)frame, info.size) == info.hash;
+    }
+}
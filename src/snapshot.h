@@ -0,0 +1,42 @@
+#ifndef snapshot_h
+#define snapshot_h
+
+#include <functional>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rle.h"
+
+namespace Project
+{
+    // A framebuffer saved as a header followed by its PackBits packed
+    // bytes, so the last frame can be put back at boot without waiting
+    // for data.
+    struct snapshot_info
+    {
+        uint8_t mode;
+        uint8_t rotation;
+        uint16_t width;
+        uint16_t height;
+        uint32_t size;
+        // Of the unpacked frame, filled in by write_snapshot and
+        // read_snapshot_info
+        uint64_t hash;
+    };
+
+    // Fills buffer with up to len bytes, returns how many; 0 at the end
+    using snapshot_source_t = std::function<size_t(uint8_t *buffer, size_t len)>;
+
+    // Returns the number of bytes written, 0 on failure
+    size_t write_snapshot(snapshot_info &info, const uint8_t *frame, const rle_sink_t &sink);
+
+    // Reads the header alone, to decide where the frame should go
+    bool read_snapshot_info(snapshot_info &info, const snapshot_source_t &source);
+
+    // After read_snapshot_info(): unpacks the frame into info.size bytes
+    // at frame and checks it against info.hash. frame is left
+    // partly written if this fails.
+    bool read_snapshot_frame(const snapshot_info &info, uint8_t *frame, const snapshot_source_t &source);
+}
+
+#endif
@@ -1,50 +1,150 @@
 #include "stream.h"
+
+#include <string.h>
+
 #include "mystring.h"
 
 namespace Project
 {
-    ostream &ostream::operator<<(const ostream &stm)
+    ostream::ostream()
+        : buffer(inline_buffer), capacity(INLINE_CAPACITY), used(0), heap(false)
+    {
+        this->buffer[0] = 0;
+    }
+
+    ostream::ostream(char *buffer, size_t capacity)
+        : buffer(buffer), capacity(capacity), used(0), heap(false)
+    {
+        if (this->capacity == 0)
+        {
+            this->buffer = this->inline_buffer;
+            this->capacity = INLINE_CAPACITY;
+        }
+        this->buffer[0] = 0;
+    }
+
+    ostream::~ostream()
+    {
+        if (this->heap)
+        {
+            delete[] this->buffer;
+        }
+    }
+
+    void ostream::reserve(size_t len)
+    {
+        // One byte is always kept for the terminating 0
+        size_t needed = this->used + len + 1;
+        if (needed <= this->capacity)
+        {
+            return;
+        }
+
+        size_t capacity = this->capacity * 2;
+        while (capacity < needed)
+        {
+            capacity *= 2;
+        }
+
+        char *buffer = new char[capacity];
+        memcpy(buffer, this->buffer, this->used + 1);
+        if (this->heap)
+        {
+            delete[] this->buffer;
+        }
+        this->buffer = buffer;
+        this->capacity = capacity;
+        this->heap = true;
+    }
+
+    void ostream::write(const char *st, size_t len)
     {
-        for (string st : stm.strings)
+        this->reserve(len);
+        memcpy(this->buffer + this->used, st, len);
+        this->used += len;
+        this->buffer[this->used] = 0;
+    }
+
+    void ostream::write_integer(long long int i, unsigned width)
+    {
+        // 20 digits covers 2^64, the sign is written separately
+        char digits[20];
+        size_t n = 0;
+
+        unsigned long long value = i < 0 ? 0ULL - (unsigned long long)i : (unsigned long long)i;
+        do
+        {
+            digits[n++] = '0' + (value % 10);
+            value /= 10;
+        } while (value > 0);
+
+        // Like printf, the width includes the sign
+        size_t sign = i < 0 ? 1 : 0;
+        size_t pad = width > n + sign ? width - n - sign : 0;
+
+        this->reserve(sign + pad + n);
+        char *out = this->buffer + this->used;
+        if (sign)
         {
-            this->strings.push_back(st);
+            *out++ = '-';
         }
+        for (size_t p = 0; p < pad; ++p)
+        {
+            *out++ = '0';
+        }
+        while (n > 0)
+        {
+            *out++ = digits[--n];
+        }
+        this->used = out - this->buffer;
+        this->buffer[this->used] = 0;
+    }
+
+    ostream &ostream::operator<<(const ostream &stm)
+    {
+        this->write(stm.buffer, stm.used);
         return *this;
     }
 
     ostream &ostream::operator<<(const char *st)
     {
-        this->strings.push_back(st);
+        this->write(st, strlen(st));
         return *this;
     }
 
     ostream &ostream::operator<<(const string &st)
     {
-        this->strings.push_back(st);
+        this->write(st.c_str(), st.length());
         return *this;
     }
 
     ostream &ostream::operator<<(char ch)
     {
-        this->strings.push_back(string::fmt("%c", ch));
+        this->write(&ch, 1);
         return *this;
     }
 
     ostream &ostream::operator<<(int i)
     {
-        this->strings.push_back(string::fmt("%d", i));
+        this->write_integer(i, 0);
         return *this;
     }
 
     ostream &ostream::operator<<(unsigned int i)
     {
-        this->strings.push_back(string::fmt("%u", i));
+        this->write_integer(i, 0);
         return *this;
     }
 
     ostream &ostream::operator<<(long long int i)
     {
-        this->strings.push_back(string::fmt("%lld", i));
+        this->write_integer(i, 0);
+        return *this;
+    }
+
+    ostream &ostream::operator<<(const zero_pad &zp)
+    {
+        this->write_integer(zp.value, zp.width);
         return *this;
     }
 
@@ -55,22 +155,28 @@ namespace Project
 
     bool ostream::empty() const
     {
-        return this->strings.size() == 0;
+        return this->used == 0;
     }
 
     void ostream::clear()
     {
-        this->strings.clear();
+        this->used = 0;
+        this->buffer[0] = 0;
+    }
+
+    const char *ostream::c_str() const
+    {
+        return this->buffer;
+    }
+
+    size_t ostream::length() const
+    {
+        return this->used;
     }
 
     string ostream::str() const
     {
-        string ret = "";
-        for (string st : this->strings)
-        {
-            ret += st;
-        }
-        return ret;
+        return string(this->buffer);
     }
 
 #ifdef ARDUINO
@@ -160,7 +266,7 @@ namespace Project
         return this->istm.get();
     }
 
-    bool istream_stl::readuntil(string &st, char delim)
+    bool istream_stl::read_until(string &st, char delim)
     {
         if (std::getline(this->istm, st, delim))
         {
@@ -9,15 +9,35 @@
 #include <istream>
 #endif
 
-#include <vector>
+#include <stddef.h>
 
 namespace Project
 {
     class string;
 
+    // Zero padded integer, e.g. out << zero_pad(month, 2) writes "07".
+    struct zero_pad
+    {
+        zero_pad(long long int value, unsigned width) : value(value), width(width) {}
+
+        long long int value;
+        unsigned width;
+    };
+
+    // Append-only text writer.
+    //
+    // Output is written into a fixed buffer, either the inline one or one
+    // supplied by the caller, and only moves to the heap if that fills up.
     class ostream
     {
     public:
+        ostream();
+        ostream(char *buffer, size_t capacity);
+        ~ostream();
+
+        ostream(const ostream &) = delete;
+        ostream &operator=(const ostream &) = delete;
+
         ostream &operator<<(const ostream &stm);
         ostream &operator<<(const char *st);
         ostream &operator<<(const string &st);
@@ -25,16 +45,29 @@ namespace Project
         ostream &operator<<(int i);
         ostream &operator<<(unsigned int i);
         ostream &operator<<(long long int i);
+        ostream &operator<<(const zero_pad &zp);
 
         operator string() const;
 
         bool empty() const;
         void clear();
 
+        const char *c_str() const;
+        size_t length() const;
         string str() const;
 
     protected:
-        std::vector<string> strings;
+        static const size_t INLINE_CAPACITY = 64;
+
+        void write(const char *st, size_t len);
+        void write_integer(long long int i, unsigned width);
+        void reserve(size_t len);
+
+        char inline_buffer[INLINE_CAPACITY];
+        char *buffer;
+        size_t capacity;
+        size_t used;
+        bool heap;
     };
 
     class istream
@@ -86,7 +119,7 @@ namespace Project
     class istream_stl : public istream
     {
     public:
-        istream_stl(&istm);
+        istream_stl(std::istream &istm);
 
         char peek() const;
         char get();
@@ -94,7 +127,7 @@ namespace Project
         bool read_until(string &st, char delim);
 
     protected:
-        &istm;
+        std::istream &istm;
     };
 #endif
 }
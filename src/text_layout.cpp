@@ -0,0 +1,209 @@
+#include "text_layout.h"
+
+#include <algorithm>
+
+namespace Project
+{
+    FontMetrics::FontMetrics(const GFXfont *font)
+        : gfxfont(font), bitmaps(font->bitmap), table(nullptr), glyph_count(font->last - font->first + 1),
+          y_advance(font->yAdvance), first(font->first), codepoints(nullptr)
+    {
+        this->glyphs.resize(this->glyph_count);
+        for (unsigned i = 0; i < this->glyphs.size(); ++i)
+        {
+            const GFXglyph &glyph = font->glyph[i];
+            this->glyphs[i] = glyph_metrics{glyph.bitmapOffset, glyph.xAdvance, glyph.xOffset, glyph.width,
+                                            glyph.height, glyph.yOffset, {0, 0, 0}};
+        }
+        this->table = this->glyphs.data();
+    }
+
+    FontMetrics::FontMetrics(const uint32_t *codepoints, const glyph_metrics *glyphs, unsigned count,
+                             const uint8_t *bitmap, unsigned y_advance)
+        : gfxfont(nullptr), bitmaps(bitmap), table(glyphs), glyph_count(count),
+          y_advance(y_advance), first(0), codepoints(codepoints)
+    {
+    }
+
+    const FontMetrics &FontMetrics::get(const GFXfont *font)
+    {
+        // Only a handful of fonts are ever used, a list is plenty
+        static std::vector<FontMetrics *> cache;
+        for (FontMetrics *metrics : cache)
+        {
+            if (metrics->gfxfont == font)
+            {
+                return *metrics;
+            }
+        }
+        FontMetrics *metrics = new FontMetrics(font);
+        cache.push_back(metrics);
+        return *metrics;
+    }
+
+    const FontMetrics::glyph_metrics *FontMetrics::glyph(uint32_t codepoint) const
+    {
+        if (this->codepoints == nullptr)
+        {
+            if (codepoint < this->first || codepoint - this->first >= this->glyph_count)
+            {
+                return nullptr;
+            }
+            return &this->table[codepoint - this->first];
+        }
+
+        const uint32_t *end = this->codepoints + this->glyph_count;
+        const uint32_t *it = std::lower_bound(this->codepoints, end, codepoint);
+        if (it == end || *it != codepoint)
+        {
+            return nullptr;
+        }
+        return &this->table[it - this->codepoints];
+    }
+
+    void TextExtent::add(const FontMetrics::glyph_metrics *glyph)
+    {
+        if (glyph == nullptr)
+        {
+            return;
+        }
+        int x1 = this->pen + glyph->offset;
+        int x2 = x1 + glyph->width - 1;
+        if (x1 < this->min_x)
+        {
+            this->min_x = x1;
+        }
+        if (x2 > this->max_x)
+        {
+            this->max_x = x2;
+        }
+        this->pen += glyph->advance;
+    }
+
+    uint32_t next_codepoint(const string_ref &text, size_t &pos)
+    {
+        uint8_t ch = text.at(pos++);
+        if (ch < 0x80)
+        {
+            return ch;
+        }
+
+        unsigned extra;
+        uint32_t codepoint;
+        if ((ch & 0xe0) == 0xc0)
+        {
+            extra = 1;
+            codepoint = ch & 0x1f;
+        }
+        else if ((ch & 0xf0) == 0xe0)
+        {
+            extra = 2;
+            codepoint = ch & 0x0f;
+        }
+        else if ((ch & 0xf8) == 0xf0)
+        {
+            extra = 3;
+            codepoint = ch & 0x07;
+        }
+        else
+        {
+            return 0xfffd;
+        }
+
+        if (pos + extra > text.length())
+        {
+            return 0xfffd;
+        }
+        for (unsigned i = 0; i < extra; ++i)
+        {
+            uint8_t cont = text.at(pos + i);
+            if ((cont & 0xc0) != 0x80)
+            {
+                return 0xfffd;
+            }
+            codepoint = (codepoint << 6) | (cont & 0x3f);
+        }
+        pos += extra;
+        return codepoint;
+    }
+
+    void wrap_text(const FontMetrics &metrics, const string_ref &text, int max_width, std::vector<TextLine> &lines)
+    {
+        const unsigned max_carry = 15;
+
+        lines.clear();
+
+        // line measures the current line, word the characters after
+        // its last space, both including the current character.
+        TextExtent line, word;
+        size_t line_start = 0;
+        size_t last_space = string_ref::npos;
+        int width_at_space = 0;
+        unsigned word_chars = 0;
+
+        size_t pos = 0;
+        while (pos < text.length())
+        {
+            size_t char_start = pos;
+            uint32_t codepoint = next_codepoint(text, pos);
+            const FontMetrics::glyph_metrics *glyph = metrics.glyph(codepoint);
+
+            TextExtent line_before = line;
+            TextExtent word_before = word;
+
+            line.add(glyph);
+            if (codepoint == ' ')
+            {
+                last_space = char_start;
+                width_at_space = line_before.width();
+                word = TextExtent();
+                word_chars = 0;
+            }
+            else
+            {
+                word.add(glyph);
+                ++word_chars;
+            }
+
+            if (line.width() <= max_width || char_start == line_start)
+            {
+                continue;
+            }
+
+            if (last_space != string_ref::npos && word_chars < max_carry)
+            {
+                // Break at the space, carry the partial word over
+                lines.push_back(TextLine{(uint16_t)line_start, (uint16_t)(last_space - line_start), (uint16_t)width_at_space});
+                line_start = last_space + 1;
+                line = word;
+                line_before = word_before;
+                last_space = string_ref::npos;
+
+                if (line.width() <= max_width || char_start == line_start)
+                {
+                    continue;
+                }
+            }
+
+            // Break before the current character
+            lines.push_back(TextLine{(uint16_t)line_start, (uint16_t)(char_start - line_start), (uint16_t)line_before.width()});
+            line_start = char_start;
+            line = TextExtent();
+            line.add(glyph);
+            word = TextExtent();
+            word_chars = 0;
+            last_space = string_ref::npos;
+            if (codepoint == ' ')
+            {
+                last_space = char_start;
+            }
+            else
+            {
+                word.add(glyph);
+                word_chars = 1;
+            }
+        }
+
+        lines.push_back(TextLine{(uint16_t)line_start, (uint16_t)(text.length() - line_start), (uint16_t)line.width()});
+    }
+}
@@ -0,0 +1,103 @@
+#ifndef text_layout_h
+#define text_layout_h
+
+#include <stdint.h>
+#include <vector>
+
+#include <gfxfont.h>
+
+#include "mystring.h"
+
+namespace Project
+{
+    // Per glyph metrics of a font, so measuring text is a table lookup
+    // per character. Compiled in GFXfonts are unpacked once; fonts from
+    // the font partition (see FontStore) are used where they are mapped.
+    class FontMetrics
+    {
+    public:
+        // Also the glyph record of the font partition format
+        struct glyph_metrics
+        {
+            uint32_t bitmap_offset;
+            uint8_t advance;
+            int8_t offset;
+            uint8_t width;
+            uint8_t height;
+            int8_t y_offset;
+            uint8_t reserved[3];
+        };
+
+        static const FontMetrics &get(const GFXfont *font);
+
+        unsigned yAdvance() const { return this->y_advance; }
+
+        // Glyph bitmaps packed 1 bit per pixel, rows following each
+        // other without padding, as in Adafruit_GFX::drawChar
+        const uint8_t *bitmap() const { return this->bitmaps; }
+
+        // nullptr if the font has no glyph for codepoint
+        const glyph_metrics *glyph(uint32_t codepoint) const;
+
+        // Position of a glyph returned by glyph() within the font
+        unsigned index(const glyph_metrics *glyph) const { return glyph - this->table; }
+        const glyph_metrics *at(unsigned index) const { return &this->table[index]; }
+        unsigned count() const { return this->glyph_count; }
+
+    protected:
+        friend class FontStore;
+
+        FontMetrics(const GFXfont *font);
+
+        // Glyphs for the sorted codepoints, all left where they are
+        FontMetrics(const uint32_t *codepoints, const glyph_metrics *glyphs, unsigned count,
+                    const uint8_t *bitmap, unsigned y_advance);
+
+        const GFXfont *gfxfont;
+        const uint8_t *bitmaps;
+        const glyph_metrics *table;
+        unsigned glyph_count;
+        uint8_t y_advance;
+
+        // Compiled in fonts cover first to first + count - 1, font
+        // partition fonts list their codepoints
+        uint32_t first;
+        const uint32_t *codepoints;
+        std::vector<glyph_metrics> glyphs;
+    };
+
+    // Horizontal extent of a run of glyphs, measured the same way as
+    // Adafruit_GFX::getTextBounds() with the cursor starting at 0.
+    class TextExtent
+    {
+    public:
+        TextExtent() : pen(0), min_x(INT16_MAX), max_x(-1) {}
+
+        void add(const FontMetrics::glyph_metrics *glyph);
+        int width() const { return this->max_x >= this->min_x ? this->max_x - this->min_x + 1 : 0; }
+
+    protected:
+        int pen;
+        int min_x;
+        int max_x;
+    };
+
+    struct TextLine
+    {
+        uint16_t offset;
+        uint16_t length;
+        uint16_t width;
+    };
+
+    // Decodes the UTF-8 sequence at pos and advances pos past it. Invalid
+    // bytes decode as U+FFFD, one byte at a time.
+    uint32_t next_codepoint(const string_ref &text, size_t &pos);
+
+    // Greedy word wrap. A line breaks at its last space if that leaves
+    // fewer than 15 characters to carry over, otherwise before the
+    // character that overflowed. Lines never split a UTF-8 sequence and
+    // there is always at least one line.
+    void wrap_text(const FontMetrics &metrics, const string_ref &text, int max_width, std::vector<TextLine> &lines);
+}
+
+#endif
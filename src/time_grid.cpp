@@ -0,0 +1,120 @@
+#include "time_grid.h"
+
+#include <algorithm>
+#include <functional>
+
+namespace Project
+{
+    TimeGrid::TimeGrid(seconds_t min_duration)
+        : min_duration(min_duration)
+    {
+    }
+
+    void TimeGrid::reset(const seconds_t *day_starts, unsigned columns)
+    {
+        this->day_starts.assign(day_starts, day_starts + columns + 1);
+        this->spans.clear();
+        this->order.clear();
+    }
+
+    void TimeGrid::add(seconds_t start, seconds_t end, unsigned slot)
+    {
+        if (end < start + this->min_duration)
+        {
+            end = start + this->min_duration;
+        }
+
+        // First day that ends after the event starts
+        unsigned columns = this->day_starts.size() - 1;
+        unsigned day = std::upper_bound(this->day_starts.begin(), this->day_starts.end(), start) - this->day_starts.begin();
+        day = day > 0 ? day - 1 : 0;
+
+        for (; day < columns && this->day_starts[day] < end; ++day)
+        {
+            seconds_t day_start = this->day_starts[day];
+            seconds_t day_end = this->day_starts[day + 1];
+            if (start >= day_end)
+            {
+                continue;
+            }
+
+            span s;
+            s.slot = slot;
+            s.day = day;
+            s.start = (start > day_start ? start : day_start) - day_start;
+            s.end = (end < day_end ? end : day_end) - day_start;
+            s.lane = 0;
+            s.lanes = 1;
+
+            this->order.add(make_sort_key(day, s.start, this->spans.size()), this->spans.size());
+            this->spans.push_back(s);
+        }
+    }
+
+    void TimeGrid::pack()
+    {
+        this->order.sort();
+        for (unsigned day = 0; day + 1 < this->day_starts.size(); ++day)
+        {
+            size_t first, last;
+            this->order.column(day, first, last);
+            this->packColumn(first, last);
+        }
+    }
+
+    // Interval partitioning: walking the spans by start time, lanes whose
+    // span has ended are handed back, and each span takes the lowest free
+    // lane or opens a new one. Active spans are a min-heap on their end
+    // time packed above the lane number. When nothing is active the
+    // group of overlapping spans is over and its lane count is known.
+    void TimeGrid::packColumn(size_t first, size_t last)
+    {
+        std::greater<uint64_t> later;
+        std::greater<uint16_t> higher;
+        this->active.clear();
+        this->free_lanes.clear();
+
+        size_t group = first;
+        uint16_t lanes = 0;
+        for (size_t i = first; i <= last; ++i)
+        {
+            span *s = i < last ? &this->spans[this->order[i].slot] : nullptr;
+
+            while (!this->active.empty() && (s == nullptr || (int32_t)(this->active.front() >> 16) <= s->start))
+            {
+                std::pop_heap(this->active.begin(), this->active.end(), later);
+                this->free_lanes.push_back(this->active.back() & 0xffff);
+                std::push_heap(this->free_lanes.begin(), this->free_lanes.end(), higher);
+                this->active.pop_back();
+            }
+
+            if (this->active.empty())
+            {
+                for (; group < i; ++group)
+                {
+                    this->spans[this->order[group].slot].lanes = lanes;
+                }
+                lanes = 0;
+                this->free_lanes.clear();
+            }
+            if (s == nullptr)
+            {
+                break;
+            }
+
+            if (this->free_lanes.empty())
+            {
+                s->lane = lanes++;
+            }
+            else
+            {
+                std::pop_heap(this->free_lanes.begin(), this->free_lanes.end(), higher);
+                s->lane = this->free_lanes.back();
+                this->free_lanes.pop_back();
+            }
+
+            this->active.push_back((uint64_t)s->end << 16 | s->lane);
+            std::push_heap(this->active.begin(), this->active.end(), later);
+        }
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef time_grid_h
+#define time_grid_h
+
+#include <stdint.h>
+#include <vector>
+
+#include "event_order.h"
+#include "types.h"
+
+namespace Project
+{
+    // Places events on an hour axis, one column per day. Events that
+    // overlap in time share their column side by side: each gets a lane,
+    // and every event in a group of overlapping events is told how many
+    // lanes that group needs.
+    class TimeGrid
+    {
+    public:
+        struct span
+        {
+            unsigned slot;
+            unsigned day;
+            // Seconds from the start of the day
+            int32_t start;
+            int32_t end;
+            uint16_t lane;
+            uint16_t lanes;
+        };
+
+        // Events shorter than min_duration take up that much time, so
+        // that they have room for a line of text
+        TimeGrid(seconds_t min_duration = 15 * 60);
+
+        // day_starts holds columns + 1 ascending times, the start of each
+        // day and the end of the last one
+        void reset(const seconds_t *day_starts, unsigned columns);
+        void setMinDuration(seconds_t min_duration) { this->min_duration = min_duration; }
+
+        // Adds a span to every day column the event covers
+        void add(seconds_t start, seconds_t end, unsigned slot);
+
+        // Assigns lanes with a sweep over each column in start order
+        void pack();
+
+        size_t size() const { return this->order.size(); }
+
+        // The spans of a day, in start order, valid after pack()
+        void column(unsigned day, size_t &first, size_t &last) const { this->order.column(day, first, last); }
+        const span &operator[](size_t i) const { return this->spans[this->order[i].slot]; }
+
+    protected:
+        void packColumn(size_t first, size_t last);
+
+        seconds_t min_duration;
+        std::vector<seconds_t> day_starts;
+        std::vector<span> spans;
+        EventOrder order;
+
+        // Sweep state, kept to reuse the memory
+        std::vector<uint64_t> active;
+        std::vector<uint16_t> free_lanes;
+    };
+}
+
+#endif
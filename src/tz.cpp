@@ -51,35 +51,24 @@ namespace Project
         this->offsetMins = OffsetTZ::parseOffset(tz);
     }
 
-    int OffsetTZ::parseOffset(const string &tz)
+    int OffsetTZ::parseOffset(const string_ref &tz)
     {
-        try
+        // e.g.: +0200
+        char sign = tz.at(0);
+        int tzH, tzM;
+        if (tz.length() == 5 &&
+            (sign == '+' || sign == '-') &&
+            tz.substr(1, 2).to_digits(tzH) &&
+            tz.substr(3, 2).to_digits(tzM))
         {
-            if (tz.length() == 5)
+            int offset = (tzH * 60) + tzM;
+            if (sign == '-')
             {
-                char sign;
-                unsigned tzH, tzM;
-
-                // e.g.: +0200
-                sign = tz.at(0);
-                tzH = tz.substr(1, 2).as_int();
-                tzM = tz.substr(3, 2).as_int();
-
-                int offset = (tzH * 60) + tzM;
-                if (sign == '-')
-                {
-                    offset *= -1;
-                }
-                return offset;
+                offset *= -1;
             }
+            return offset;
         }
-        catch (std::invalid_argument const &e)
-        {
-        }
-        catch (std::out_of_range const &e)
-        {
-        }
-        throw ValueError("Bad timezone: \"" + tz + "\"");
+        throw ValueError("Bad timezone: \"" + tz.str() + "\"");
     }
 
     void OffsetTZ::output_details(ostream &out) const
@@ -96,8 +85,8 @@ namespace Project
             {
                 out << "+";
             }
-            out << string::fmt(fmt_02d, offsetMins / 60);
-            out << string::fmt(fmt_02d, offsetMins % 60);
+            out << zero_pad(offsetMins / 60, 2);
+            out << zero_pad(offsetMins % 60, 2);
         }
     }
 
@@ -41,7 +41,7 @@ namespace Project
 
         int offset() const;
 
-        static int parseOffset(const string &offset);
+        static int parseOffset(const string_ref &offset);
 
     private:
         int offsetMins;
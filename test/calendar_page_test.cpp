@@ -0,0 +1,169 @@
+#include <string>
+#include <vector>
+
+#include "calendar_page.h"
+#include "check.h"
+#include "tz.h"
+
+using namespace Project;
+
+// Every glyph up to U+007E 8 wide with an advance of 10, space blank
+static GFXglyph glyphs[0x7f - 0x20];
+static GFXfont font = {nullptr, glyphs, 0x20, 0x7e, 29};
+
+static const Date BEGIN(2024, 3, 4);
+
+static seconds_t at(int day, int hour, int minute)
+{
+    return (BEGIN + day).start_of_day(tz_UTC).epoch_time.epochSeconds + hour * 3600 + minute * 60;
+}
+
+static entry make_entry(const std::string &title, seconds_t start, seconds_t end, int importance = 1,
+                        status_t status = pending)
+{
+    DateTime start_time(start, tz_UTC), end_time(end, tz_UTC);
+    return entry(title, start_time, end_time, start_time.date(), end_time.date(), 0, status, importance);
+}
+
+// The layout of config.h.src on a 1024x758 panel
+static page_style make_style(const FontMetrics &metrics)
+{
+    page_style style;
+    style.width = 1024;
+    style.height = 758;
+    style.column_width = (style.width - 2 * style.border_width) / style.columns;
+    style.title_font = &metrics;
+    style.small_font = &metrics;
+    return style;
+}
+
+int main()
+{
+    for (GFXglyph &glyph : glyphs)
+    {
+        glyph = GFXglyph{0, 8, 10, 10, 0, -10};
+    }
+    glyphs[0].width = 0;
+    const FontMetrics &metrics = FontMetrics::get(&font);
+    page_style style = make_style(metrics);
+
+    // Statuses follow the clock, apart from what the server settled
+    {
+        entry event = make_entry("dentist", at(0, 9, 0), at(0, 10, 0));
+        CHECK(CalendarPage::statusAt(event, at(0, 8, 59)) == pending);
+        CHECK(CalendarPage::statusAt(event, at(0, 9, 0)) == in_progress);
+        CHECK(CalendarPage::statusAt(event, at(0, 10, 0)) == completed);
+        CHECK(CalendarPage::nextStatusChange(event, at(0, 8, 0)) == at(0, 9, 0));
+        CHECK(CalendarPage::nextStatusChange(event, at(0, 9, 30)) == at(0, 10, 0));
+        CHECK(CalendarPage::nextStatusChange(event, at(0, 11, 0)) == 0);
+
+        event.status = cancelled;
+        CHECK(CalendarPage::statusAt(event, at(0, 9, 30)) == cancelled);
+        CHECK(CalendarPage::nextStatusChange(event, at(0, 8, 0)) == 0);
+
+        event.status = in_progress;
+        CHECK(CalendarPage::statusAt(event, at(0, 8, 0)) == in_progress);
+        CHECK(CalendarPage::nextStatusChange(event, at(0, 8, 0)) == at(0, 10, 0));
+    }
+
+    // Twelve one line events on the first day, more than fit above the
+    // badge, and a few on other days and off the page
+    std::vector<entry> events;
+    for (int i = 0; i < 12; ++i)
+    {
+        events.push_back(make_entry("event " + std::to_string(i), at(0, 8, i * 30), at(0, 8, i * 30 + 20),
+                                    i % 4 == 3 ? 0 : 1));
+    }
+    events.push_back(make_entry("overnight", at(-1, 22, 0), at(0, 2, 0)));
+    events.push_back(make_entry("football practice", at(2, 17, 0), at(2, 18, 0)));
+    events.push_back(make_entry("next week", at(7, 9, 0), at(7, 10, 0)));
+
+    LayoutCache cache(64);
+    CalendarPage calendar(style, cache, tz_UTC);
+    CHECK(calendar.generation() == 0);
+    calendar.setEvents(std::vector<entry>(events));
+    CHECK(calendar.generation() == 1);
+    CHECK(calendar.events().size() == events.size());
+
+    {
+        DisplayList list;
+        page_layout layout;
+        calendar.drawData(list, BEGIN, at(0, 7, 0), layout);
+        CHECK(list.size() > 0);
+        CHECK(layout.begin_date == BEGIN);
+        CHECK(layout.entries.size() == 14);
+
+        // The overnight event goes in the first column and takes one of
+        // its places, so the three least important are hidden and then
+        // the latest of the rest
+        CHECK(layout.hidden.size() == 4);
+        for (unsigned slot : layout.hidden)
+        {
+            CHECK(layout.entries[slot].importance == 0 || layout.entries[slot].title == "event 10");
+        }
+        CHECK(layout.boxes.size() == 10);
+
+        const int column_top = style.border_top + style.header_height + 1;
+        const int badge_top = style.height - style.border_bottom - style.inside_spacing_width - 24;
+        int last_bottom[5] = {column_top - 1, column_top - 1, column_top - 1, column_top - 1, column_top - 1};
+        for (const event_box &box : layout.boxes)
+        {
+            const entry &event = layout.entries[box.slot];
+            CHECK(box.day == event.day);
+            CHECK(box.y_top == last_bottom[box.day] + 1);
+            CHECK(box.y_bottom < badge_top);
+            CHECK(box.line_count == 1);
+            CHECK(event.status == (event.title == "overnight" ? completed : pending));
+            last_bottom[box.day] = box.y_bottom;
+        }
+        CHECK(layout.entries[layout.boxes[0].slot].title == "overnight");
+        CHECK(layout.boxes[0].day == 0);
+        CHECK(layout.boxes.back().day == 2);
+
+        // Only boxes whose status changed are drawn again, the hidden
+        // events still count for the next change
+        DisplayList status_list;
+        seconds_t next_change = 0;
+        CHECK(calendar.refreshStatuses(status_list, layout, at(0, 7, 0), next_change) == 0);
+        CHECK(status_list.size() == 0);
+        CHECK(next_change == at(0, 8, 0));
+
+        CHECK(calendar.refreshStatuses(status_list, layout, at(0, 8, 0), next_change) == 1);
+        CHECK(status_list.size() > 0);
+        CHECK(next_change == at(0, 8, 20));
+
+        status_list.clear();
+        CHECK(calendar.refreshStatuses(status_list, layout, at(0, 13, 50), next_change) == 8);
+        CHECK(next_change == at(2, 17, 0));
+        CHECK(calendar.refreshStatuses(status_list, layout, at(3, 0, 0), next_change) == 1);
+        CHECK(next_change == 0);
+    }
+
+    // The time grid view puts every event on the page in a box on the
+    // hour axis, clamped to the hours shown
+    {
+        page_style grid_style = style;
+        grid_style.time_grid = true;
+        CalendarPage grid_calendar(grid_style, cache, tz_UTC);
+        grid_calendar.setEvents(std::vector<entry>(events));
+
+        DisplayList list;
+        page_layout layout;
+        grid_calendar.drawData(list, BEGIN, at(0, 7, 0), layout);
+        CHECK(layout.boxes.empty());
+        CHECK(layout.hidden.empty());
+        CHECK(layout.grid_boxes.size() == 14);
+        for (const grid_box &box : layout.grid_boxes)
+        {
+            CHECK(box.y1 >= grid_style.border_top + grid_style.header_height + 1);
+            CHECK(box.y2 <= grid_style.height - grid_style.border_bottom - 1);
+            CHECK(box.x1 < box.x2);
+        }
+
+        DisplayList status_list;
+        seconds_t next_change = 0;
+        CHECK(grid_calendar.refreshStatuses(status_list, layout, at(0, 8, 0), next_change) == 1);
+    }
+
+    return test_result();
+}
@@ -0,0 +1,38 @@
+#ifndef check_h
+#define check_h
+
+#include <stdio.h>
+
+// Just enough to report failures from a host test: CHECK() prints the
+// ones that fail and carries on, test_result() is what main returns.
+namespace Project
+{
+    inline int &test_failures()
+    {
+        static int failures = 0;
+        return failures;
+    }
+
+    inline int test_result()
+    {
+        if (test_failures() != 0)
+        {
+            printf("%d checks failed\n", test_failures());
+            return 1;
+        }
+        printf("all checks passed\n");
+        return 0;
+    }
+}
+
+#define CHECK(condition)                                                        \
+    do                                                                          \
+    {                                                                           \
+        if (!(condition))                                                       \
+        {                                                                       \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            ++Project::test_failures();                                         \
+        }                                                                       \
+    } while (0)
+
+#endif
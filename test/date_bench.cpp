@@ -0,0 +1,37 @@
+#include <chrono>
+#include <stdio.h>
+
+#include "date.h"
+#include "date_loops.h"
+
+using namespace Project;
+
+// incDay() closed form against the month by month loop it replaced
+int main()
+{
+    const int calls = 20000;
+    unsigned sum = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; ++i)
+    {
+        loop_date date = {1970, 1, 1};
+        loop_inc_day(date, i * 2);
+        sum += date.day;
+    }
+    auto middle = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; ++i)
+    {
+        Date date(1970, 1, 1);
+        date.incDay(i * 2);
+        sum += date.day;
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    using std::chrono::duration_cast;
+    using std::chrono::microseconds;
+    printf("%d incDay calls: loop %lld us, closed form %lld us (%u)\n", calls,
+           (long long)duration_cast<microseconds>(middle - start).count(),
+           (long long)duration_cast<microseconds>(end - middle).count(), sum);
+    return 0;
+}
@@ -0,0 +1,52 @@
+#ifndef date_loops_h
+#define date_loops_h
+
+#include "datecalc.h"
+
+// The month by month loops Date::incDay() and incMonth() used before
+// they were closed form, kept as a reference for the test and the
+// benchmark. Only the forward steps: decMonth() was wrong.
+namespace Project
+{
+    struct loop_date
+    {
+        unsigned year;
+        unsigned month;
+        unsigned day;
+    };
+
+    inline void loop_inc_month(loop_date &date, unsigned n)
+    {
+        date.month--;
+        date.month += n;
+        if (date.month > 11)
+        {
+            date.year += date.month / 12;
+        }
+        date.month %= 12;
+        date.month++;
+    }
+
+    inline void loop_inc_day(loop_date &date, unsigned n)
+    {
+        date.day--;
+        date.day += n;
+        while (true)
+        {
+            if (date.day < 27)
+            {
+                break;
+            }
+            unsigned last_day = last_day_of_month(date.year, date.month);
+            if (date.day < last_day)
+            {
+                break;
+            }
+            date.day -= last_day;
+            loop_inc_month(date, 1);
+        }
+        date.day++;
+    }
+}
+
+#endif
@@ -0,0 +1,214 @@
+#include <stdio.h>
+#include <time.h>
+
+#include "check.h"
+#include "date.h"
+#include "date_loops.h"
+#include "datecalc.h"
+
+using namespace Project;
+
+// Month steps done naively, sharing nothing with Date or datecalc: one
+// month at a time, then the day clamped or carried a day at a time
+// into the following month
+static bool naive_leap(unsigned year)
+{
+    return year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+}
+
+static unsigned naive_month_length(unsigned year, unsigned month)
+{
+    static const unsigned lengths[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    return month == 2 && naive_leap(year) ? 29 : lengths[month - 1];
+}
+
+static Date naive_add_months(const Date &date, int n, Date::MonthEnd policy)
+{
+    unsigned year = date.year, month = date.month;
+    for (; n > 0; --n)
+    {
+        if (++month > 12)
+        {
+            month = 1;
+            ++year;
+        }
+    }
+    for (; n < 0; ++n)
+    {
+        if (--month < 1)
+        {
+            month = 12;
+            --year;
+        }
+    }
+
+    unsigned length = naive_month_length(year, month);
+    if (date.day <= length || policy == Date::MonthEnd::CLAMP)
+    {
+        return Date(year, month, date.day <= length ? date.day : length);
+    }
+    unsigned day = length;
+    for (unsigned extra = date.day - length; extra > 0; --extra)
+    {
+        if (++day > naive_month_length(year, month))
+        {
+            day = 1;
+            if (++month > 12)
+            {
+                month = 1;
+                ++year;
+            }
+        }
+    }
+    return Date(year, month, day);
+}
+
+static bool same(const Date &date, const loop_date &loop)
+{
+    return date.year == loop.year && date.month == loop.month && date.day == loop.day;
+}
+
+// Every day from 1970 to 2100
+static void check_every_day()
+{
+    const int first = days_from_civil(1970, 1, 1);
+    const int last = days_from_civil(2100, 12, 31);
+    const int day_steps[] = {1, -1, 27, 31, 365, -400, 1000};
+    const int month_steps[] = {1, -1, 5, 11, -13, 24};
+    long checks = 0;
+
+    for (int index = first; index <= last; ++index)
+    {
+        Date date((days_t)index);
+        CHECK((int)days_from_civil(date.year, date.month, date.day) == index);
+
+        for (int n : day_steps)
+        {
+            if (index + n < first)
+            {
+                continue;
+            }
+            Date stepped = date;
+            stepped.addDays(n);
+            CHECK((int)days_from_civil(stepped.year, stepped.month, stepped.day) == index + n);
+            ++checks;
+
+            if (n > 0)
+            {
+                // Against the loops the closed form replaced
+                Date inc = date;
+                inc.incDay(n);
+                loop_date loop = {date.year, date.month, date.day};
+                loop_inc_day(loop, n);
+                CHECK(same(inc, loop));
+
+                Date dec = stepped;
+                dec.decDay(n);
+                CHECK(dec == date);
+                checks += 2;
+            }
+        }
+
+        for (int n : month_steps)
+        {
+            // Dates start in 1970
+            if ((int)date.year * 12 + (int)date.month - 1 + n < 1970 * 12)
+            {
+                continue;
+            }
+            for (Date::MonthEnd policy : {Date::MonthEnd::CLAMP, Date::MonthEnd::ROLL_OVER})
+            {
+                Date stepped = date;
+                stepped.addMonths(n, policy);
+                CHECK(stepped == naive_add_months(date, n, policy));
+                ++checks;
+            }
+
+            if (n > 0 && date.day <= 28)
+            {
+                Date inc = date;
+                inc.incMonth(n);
+                loop_date loop = {date.year, date.month, date.day};
+                loop_inc_month(loop, n);
+                CHECK(same(inc, loop));
+                ++checks;
+            }
+        }
+
+        // ISO weeks against the C library
+        time_t t = (time_t)index * 86400;
+        struct tm tm;
+        gmtime_r(&t, &tm);
+        char buffer[16];
+        strftime(buffer, sizeof(buffer), "%G %V", &tm);
+        unsigned iso_year, iso_week;
+        sscanf(buffer, "%u %u", &iso_year, &iso_week);
+        CHECK(date.isoYear() == iso_year);
+        CHECK(date.weekNo() == iso_week);
+        CHECK(Date::fromIsoWeek(iso_year, iso_week, date.getDayOfWeek()) == date);
+        checks += 3;
+    }
+
+    printf("%ld checks\n", checks);
+}
+
+// Known answers, worked out by hand
+static void check_month_ends()
+{
+    struct month_case
+    {
+        Date date;
+        int months;
+        Date::MonthEnd policy;
+        Date expected;
+    };
+    const Date::MonthEnd CLAMP = Date::MonthEnd::CLAMP, ROLL_OVER = Date::MonthEnd::ROLL_OVER;
+    const month_case cases[] = {
+        {Date(2023, 1, 31), 1, CLAMP, Date(2023, 2, 28)},
+        {Date(2023, 1, 31), 1, ROLL_OVER, Date(2023, 3, 3)},
+        {Date(2024, 1, 31), 1, CLAMP, Date(2024, 2, 29)},
+        {Date(2024, 1, 31), 1, ROLL_OVER, Date(2024, 3, 2)},
+        {Date(2024, 2, 29), 12, CLAMP, Date(2025, 2, 28)},
+        {Date(2024, 2, 29), 12, ROLL_OVER, Date(2025, 3, 1)},
+        {Date(2024, 2, 29), 48, CLAMP, Date(2028, 2, 29)},
+        {Date(2024, 3, 31), -1, CLAMP, Date(2024, 2, 29)},
+        {Date(2023, 3, 31), -1, ROLL_OVER, Date(2023, 3, 3)},
+        {Date(2023, 5, 31), 1, CLAMP, Date(2023, 6, 30)},
+        {Date(2023, 5, 31), 1, ROLL_OVER, Date(2023, 7, 1)},
+        {Date(2023, 12, 31), 2, CLAMP, Date(2024, 2, 29)},
+        {Date(2023, 12, 15), 1, CLAMP, Date(2024, 1, 15)},
+        {Date(2024, 1, 15), -1, CLAMP, Date(2023, 12, 15)},
+        {Date(2099, 12, 31), -22, ROLL_OVER, Date(2098, 3, 3)},
+        {Date(2100, 1, 29), 1, ROLL_OVER, Date(2100, 3, 1)},
+        {Date(2000, 1, 30), 1, CLAMP, Date(2000, 2, 29)},
+        {Date(1970, 1, 31), 0, ROLL_OVER, Date(1970, 1, 31)},
+    };
+    for (const month_case &c : cases)
+    {
+        Date date = c.date;
+        date.addMonths(c.months, c.policy);
+        CHECK(date == c.expected);
+        CHECK(naive_add_months(c.date, c.months, c.policy) == c.expected);
+    }
+
+    Date date(2024, 2, 29);
+    date.addYears(1);
+    CHECK(date == Date(2025, 2, 28));
+
+    // decMonth() used to reset to month 11 inside its loop
+    date = Date(2023, 3, 15);
+    date.decMonth(5);
+    CHECK(date == Date(2022, 10, 15));
+
+    // incMonth() used to leave the day past the end of the month
+    date = Date(2023, 1, 31);
+    date.incMonth(1);
+    CHECK(date == Date(2023, 2, 28));
+}
+
+int main()
+{
+    check_every_day();
+    check_month_ends();
+    return test_result();
+}
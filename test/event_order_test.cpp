@@ -0,0 +1,109 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "check.h"
+#include "error.h"
+#include "event_order.h"
+
+using namespace Project;
+
+// The radix sort against std::stable_sort on the same keys, with plenty
+// of equal keys and events starting before the window
+static void check_sort_matches_stable_sort()
+{
+    std::mt19937 rng(1);
+    for (int trial = 0; trial < 200; ++trial)
+    {
+        unsigned n = rng() % 2000;
+        EventOrder order;
+        std::vector<EventOrder::item> expected;
+        for (unsigned slot = 0; slot < n; ++slot)
+        {
+            seconds_t start = (seconds_t)(rng() % 800) * 1000 - 200000;
+            sort_key_t key = make_sort_key(rng() % 5, start, rng() % 4);
+            order.add(key, slot);
+            expected.push_back(EventOrder::item{key, slot});
+        }
+
+        order.sort();
+        std::stable_sort(expected.begin(), expected.end(),
+                         [](const EventOrder::item &a, const EventOrder::item &b)
+                         { return a.key < b.key; });
+
+        CHECK(order.size() == n);
+        bool same = true;
+        for (unsigned i = 0; i < n; ++i)
+        {
+            same = same && order[i].slot == expected[i].slot;
+        }
+        CHECK(same);
+
+        for (unsigned day = 0; day < 5; ++day)
+        {
+            size_t first, last;
+            order.column(day, first, last);
+            for (size_t i = first; i < last; ++i)
+            {
+                CHECK(sort_key_day(order[i].key) == day);
+            }
+            CHECK(first == 0 || sort_key_day(order[first - 1].key) < day);
+            CHECK(last == order.size() || sort_key_day(order[last].key) > day);
+        }
+    }
+}
+
+static void check_key_order()
+{
+    // Column first, then start time, earlier than the window included,
+    // then the tie breaker
+    CHECK(make_sort_key(0, 1000000, 9) < make_sort_key(1, -1000000, 0));
+    CHECK(make_sort_key(2, -60, 9) < make_sort_key(2, 0, 0));
+    CHECK(make_sort_key(2, 0, 1) < make_sort_key(2, 0, 2));
+    CHECK(sort_key_day(make_sort_key(7, -3600, 3)) == 7);
+}
+
+static void check_insert_and_remove()
+{
+    std::mt19937 rng(2);
+    EventOrder order;
+    for (unsigned slot = 0; slot < 500; ++slot)
+    {
+        order.insert(make_sort_key(rng() % 5, rng() % 10 * 600, 0), slot);
+    }
+    for (size_t i = 1; i < order.size(); ++i)
+    {
+        CHECK(order[i - 1].key <= order[i].key);
+        // Equal keys stay in insertion order
+        CHECK(order[i - 1].key < order[i].key || order[i - 1].slot < order[i].slot);
+    }
+
+    CHECK(order.remove(7));
+    CHECK(!order.remove(7));
+    CHECK(order.size() == 499);
+}
+
+static void check_tie_breaker_limit()
+{
+    make_sort_key(0, 0, MAX_TIE_BREAKER);
+
+    bool thrown = false;
+    try
+    {
+        make_sort_key(0, 0, MAX_TIE_BREAKER + 1);
+    }
+    catch (const ValueError &)
+    {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
+
+int main()
+{
+    check_sort_matches_stable_sort();
+    check_key_order();
+    check_insert_and_remove();
+    check_tie_breaker_limit();
+    return test_result();
+}
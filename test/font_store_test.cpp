@@ -0,0 +1,138 @@
+#include <string.h>
+#include <vector>
+
+#include "check.h"
+#include "font_store.h"
+
+using namespace Project;
+
+// Image builder following the layout in font_store.h
+class Image
+{
+public:
+    std::vector<uint8_t> bytes;
+
+    void u8(uint8_t value) { this->bytes.push_back(value); }
+    void u16(uint16_t value)
+    {
+        this->u8(value & 0xff);
+        this->u8(value >> 8);
+    }
+    void u32(uint32_t value)
+    {
+        this->u16(value & 0xffff);
+        this->u16(value >> 16);
+    }
+    void put32(size_t at, uint32_t value)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            this->bytes[at + i] = (value >> (8 * i)) & 0xff;
+        }
+    }
+};
+
+const size_t HEADER_SIZE = 8;
+const size_t FONT_SIZE = FontStore::NAME_LENGTH + 24;
+const size_t GLYPH_COUNT_AT = HEADER_SIZE + FontStore::NAME_LENGTH;
+
+// One font called "test" with glyphs for 'A' and 'B', 2x8 pixels each
+static Image make_image()
+{
+    Image image;
+    image.u32(FontStore::MAGIC);
+    image.u16(FontStore::VERSION);
+    image.u16(1);
+
+    size_t codepoints = HEADER_SIZE + FONT_SIZE;
+    size_t glyphs = codepoints + 2 * 4;
+    size_t bitmap = glyphs + 2 * sizeof(FontMetrics::glyph_metrics);
+
+    const char name[FontStore::NAME_LENGTH] = "test";
+    for (char ch : name)
+    {
+        image.u8(ch);
+    }
+    image.u32(2);
+    image.u32(codepoints);
+    image.u32(glyphs);
+    image.u32(bitmap);
+    image.u32(4);
+    image.u8(12);
+    image.u8(0);
+    image.u8(0);
+    image.u8(0);
+
+    image.u32('A');
+    image.u32('B');
+    for (uint32_t offset : {0, 2})
+    {
+        image.u32(offset);
+        image.u8(3);     // advance
+        image.u8(0);     // offset
+        image.u8(2);     // width
+        image.u8(8);     // height
+        image.u8(-8);    // y offset
+        image.u8(0);
+        image.u8(0);
+        image.u8(0);
+    }
+    image.u32(0xffffffff);
+    return image;
+}
+
+int main()
+{
+    {
+        Image image = make_image();
+        FontStore store(image.bytes.data(), image.bytes.size());
+        CHECK(store.valid());
+        const FontMetrics *metrics = store.find("test");
+        CHECK(metrics != nullptr);
+        if (metrics != nullptr)
+        {
+            CHECK(metrics->count() == 2);
+            CHECK(metrics->yAdvance() == 12);
+            CHECK(metrics->glyph('B') == metrics->at(1));
+            CHECK(metrics->glyph('C') == nullptr);
+        }
+        CHECK(store.find("other") == nullptr);
+    }
+
+    // Truncated anywhere, the font is dropped
+    {
+        Image image = make_image();
+        for (size_t size = 0; size < image.bytes.size(); ++size)
+        {
+            FontStore store(image.bytes.data(), size);
+            CHECK(!store.valid());
+        }
+    }
+
+    // Glyph counts the image can't hold. With a 32 bit size_t the glyph
+    // table sizes of the first two wrap around to 8 and 0 bytes, which
+    // would pass the bounds checks.
+    for (uint32_t count : {0x15555556u, 0x40000000u, 0xffffffffu})
+    {
+        Image image = make_image();
+        image.put32(GLYPH_COUNT_AT, count);
+        FontStore store(image.bytes.data(), image.bytes.size());
+        CHECK(!store.valid());
+    }
+
+    // Unsorted codepoints and bitmaps past the end are rejected too
+    {
+        Image image = make_image();
+        image.put32(HEADER_SIZE + FONT_SIZE, 'C');
+        FontStore store(image.bytes.data(), image.bytes.size());
+        CHECK(!store.valid());
+    }
+    {
+        Image image = make_image();
+        image.put32(HEADER_SIZE + FONT_SIZE + 8 + sizeof(FontMetrics::glyph_metrics), 3);
+        FontStore store(image.bytes.data(), image.bytes.size());
+        CHECK(!store.valid());
+    }
+
+    return test_result();
+}
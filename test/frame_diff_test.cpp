@@ -0,0 +1,94 @@
+#include <random>
+#include <vector>
+
+#include "check.h"
+#include "frame_diff.h"
+
+using namespace Project;
+
+const int WIDTH = 1024;
+const int HEIGHT = 758;
+
+int main()
+{
+    std::mt19937 rng(11);
+
+    // Every change shows up, in both frame formats, wherever it is in
+    // the tile. Changes to the last byte of each row of a 1-bit tile
+    // used to cancel out in the hash now and then.
+    for (int bits : {1, 4})
+    {
+        const size_t stride = WIDTH * bits / 8;
+        const size_t tile_bytes = TileDiff::TILE_SIZE * bits / 8;
+        std::vector<uint8_t> frame(stride * HEIGHT, 0xff);
+        TileDiff diff(WIDTH, HEIGHT, bits);
+        diff.update(frame.data());
+        CHECK(diff.dirty_tiles() == diff.total_tiles());
+        diff.commit();
+
+        int missed = 0;
+        for (int trial = 0; trial < 20000; ++trial)
+        {
+            std::vector<uint8_t> next = frame;
+            int tx = rng() % (WIDTH / TileDiff::TILE_SIZE);
+            int ty = rng() % (HEIGHT / TileDiff::TILE_SIZE);
+            size_t column = tx * tile_bytes + (trial % 2 ? tile_bytes - 1 : rng() % tile_bytes);
+            int rows = 2 + rng() % 8;
+            for (int r = 0; r < rows; ++r)
+            {
+                int y = ty * TileDiff::TILE_SIZE + rng() % TileDiff::TILE_SIZE;
+                next[y * stride + column] ^= 1 + rng() % 255;
+            }
+            if (next == frame)
+            {
+                continue;
+            }
+
+            diff.update(next.data());
+            bool found = false;
+            for (const Rect &rect : diff.regions())
+            {
+                found = found || (rect.x == tx * TileDiff::TILE_SIZE && rect.y == ty * TileDiff::TILE_SIZE);
+            }
+            missed += !found || diff.dirty_tiles() != 1;
+            diff.commit();
+            frame = next;
+        }
+        CHECK(missed == 0);
+
+        // Nothing changed, nothing dirty
+        diff.update(frame.data());
+        CHECK(diff.dirty_tiles() == 0);
+        CHECK(diff.regions().empty());
+    }
+
+    // Neighbouring dirty tiles come back as one region, the bottom row
+    // of tiles cut to the frame
+    {
+        const size_t stride = WIDTH / 8;
+        std::vector<uint8_t> frame(stride * HEIGHT, 0);
+        TileDiff diff(WIDTH, HEIGHT, 1);
+        diff.update(frame.data());
+        diff.commit();
+
+        for (int y = 700; y < HEIGHT; ++y)
+        {
+            for (int x = 64; x < 160; x += 8)
+            {
+                frame[y * stride + x / 8] = 0xff;
+            }
+        }
+        diff.update(frame.data());
+        CHECK(diff.dirty_tiles() == 9);
+        CHECK(diff.regions().size() == 1);
+        if (diff.regions().size() == 1)
+        {
+            const Rect &rect = diff.regions()[0];
+            CHECK(rect.x == 64 && rect.w == 96);
+            CHECK(rect.y == 672 && rect.h == HEIGHT - 672);
+        }
+        CHECK(diff.dirty_pixels() == 96 * (HEIGHT - 672));
+    }
+
+    return test_result();
+}
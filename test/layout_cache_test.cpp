@@ -0,0 +1,147 @@
+#include <random>
+#include <string>
+#include <vector>
+
+#include "check.h"
+#include "layout_cache.h"
+
+using namespace Project;
+
+// Every glyph up to U+007E 8 wide with an advance of 10, space blank
+static GFXglyph glyphs[0x7f - 0x20];
+static GFXfont font = {nullptr, glyphs, 0x20, 0x7e, 29};
+
+// Gives two texts the same primary hash, as a real collision would
+class CollidingCache : public LayoutCache
+{
+public:
+    CollidingCache(size_t capacity) : LayoutCache(capacity) {}
+
+    void collide(const FontMetrics &metrics, const std::string &cached, const std::string &other, int max_width)
+    {
+        size_t bucket = this->probe(make_key(metrics, cached, max_width));
+        CHECK(this->buckets[bucket] != NIL);
+        this->slots[this->buckets[bucket]].key.hash = make_key(metrics, other, max_width).hash;
+
+        // Rehash everything so the entry sits where its new hash puts it
+        for (size_t i = 0; i <= this->mask; ++i)
+        {
+            this->buckets[i] = NIL;
+        }
+        for (uint16_t index = this->head; index != NIL; index = this->slots[index].next)
+        {
+            this->buckets[this->probe(this->slots[index].key)] = index;
+        }
+    }
+};
+
+static bool same_layout(const FontMetrics &metrics, const std::string &text, int max_width, const TextLayout &layout)
+{
+    std::vector<TextLine> expected;
+    wrap_text(metrics, text, max_width, expected);
+    if (layout.count != expected.size() || layout.height != expected.size() * metrics.yAdvance())
+    {
+        return false;
+    }
+    for (unsigned i = 0; i < layout.count; ++i)
+    {
+        const TextLine &line = layout.lines[i];
+        if (line.offset != expected[i].offset || line.length != expected[i].length || line.width != expected[i].width)
+        {
+            return false;
+        }
+        if (line.offset + line.length > text.size())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static std::string random_title(std::mt19937 &rng)
+{
+    std::string text;
+    unsigned words = 1 + rng() % 8;
+    for (unsigned w = 0; w < words; ++w)
+    {
+        if (w > 0)
+        {
+            text += ' ';
+        }
+        unsigned length = 1 + rng() % 10;
+        for (unsigned i = 0; i < length; ++i)
+        {
+            text += (char)('a' + rng() % 26);
+        }
+    }
+    return text;
+}
+
+int main()
+{
+    for (GFXglyph &glyph : glyphs)
+    {
+        glyph = GFXglyph{0, 8, 10, 10, 0, -10};
+    }
+    glyphs[0].width = 0;
+    const FontMetrics &metrics = FontMetrics::get(&font);
+
+    // Hits, misses and evictions all give what wrap_text() gives
+    {
+        LayoutCache cache(16);
+        std::mt19937 rng(7);
+        std::vector<std::string> titles;
+        for (int i = 0; i < 40; ++i)
+        {
+            titles.push_back(random_title(rng));
+        }
+        for (int i = 0; i < 5000; ++i)
+        {
+            const std::string &title = titles[rng() % (i % 2 ? 12 : titles.size())];
+            int max_width = 100 + 50 * (rng() % 2);
+            CHECK(same_layout(metrics, title, max_width, cache.layout(metrics, title, max_width)));
+        }
+        CHECK(cache.size() == 16);
+        CHECK(cache.stats().hits > 0);
+        CHECK(cache.stats().evictions > 0);
+    }
+
+    // The same text in another width is another entry
+    {
+        LayoutCache cache(4);
+        std::string title = "quarterly planning review";
+        CHECK(cache.layout(metrics, title, 100).count == 3);
+        CHECK(cache.layout(metrics, title, 300).count == 1);
+        CHECK(cache.layout(metrics, title, 100).count == 3);
+        CHECK(cache.stats().hits == 1);
+        CHECK(cache.stats().misses == 2);
+    }
+
+    // A short title whose hash collides with a long one cached earlier
+    // misses rather than getting its lines, which would reach past its end
+    {
+        CollidingCache cache(8);
+        std::string long_title = "an all hands meeting about the roadmap";
+        std::string short_title = "lunch";
+        cache.layout(metrics, long_title, 100);
+        cache.collide(metrics, long_title, short_title, 100);
+
+        CHECK(same_layout(metrics, short_title, 100, cache.layout(metrics, short_title, 100)));
+        CHECK(cache.stats().hits == 0);
+        CHECK(cache.stats().misses == 2);
+
+        // Both entries live on under the same hash
+        CHECK(same_layout(metrics, short_title, 100, cache.layout(metrics, short_title, 100)));
+        CHECK(cache.stats().hits == 1);
+        CHECK(cache.size() == 2);
+
+        // and evicting one leaves the other findable
+        for (int i = 0; i < 8; ++i)
+        {
+            cache.layout(metrics, std::string(1, 'a' + i), 100);
+        }
+        CHECK(same_layout(metrics, short_title, 100, cache.layout(metrics, short_title, 100)));
+    }
+
+    return test_result();
+}
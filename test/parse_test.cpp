@@ -0,0 +1,68 @@
+#include "check.h"
+#include "date.h"
+#include "error.h"
+#include "mystring.h"
+#include "mytime.h"
+#include "tz.h"
+
+using namespace Project;
+
+template <typename F>
+static bool rejects(F parse)
+{
+    try
+    {
+        parse();
+    }
+    catch (const ValueError &)
+    {
+        return true;
+    }
+    return false;
+}
+
+static void check_numbers()
+{
+    int value = 0;
+    CHECK(string_ref("-7").to_int(value) && value == -7);
+    CHECK(string_ref("+12").to_int(value) && value == 12);
+    CHECK(string_ref("2147483647").to_int(value) && value == 2147483647);
+    CHECK(!string_ref("2147483648").to_int(value));
+    CHECK(!string_ref("").to_int(value));
+    CHECK(!string_ref("-").to_int(value));
+    CHECK(!string_ref("+-1").to_int(value));
+    CHECK(!string_ref("1 2").to_int(value));
+
+    CHECK(string_ref("0105").to_digits(value) && value == 105);
+    CHECK(!string_ref("+1").to_digits(value));
+    CHECK(!string_ref("-1").to_digits(value));
+    CHECK(!string_ref("").to_digits(value));
+}
+
+// Fixed width fields are digits only, a sign inside one isn't a number
+static void check_fixed_width_fields()
+{
+    Date date(string_ref("20240105"));
+    CHECK(date.year == 2024 && date.month == 1 && date.day == 5);
+    CHECK(rejects([] { Date(string_ref("2024+1+5")); }));
+    CHECK(rejects([] { Date(string_ref("2024-1-5")); }));
+    CHECK(rejects([] { Date(string_ref("+2024105")); }));
+
+    Time time(string_ref("093007"));
+    CHECK(time.hour == 9 && time.minute == 30 && time.second == 7);
+    CHECK(rejects([] { Time(string_ref("+93007")); }));
+    CHECK(rejects([] { Time(string_ref("09-307")); }));
+
+    CHECK(OffsetTZ::parseOffset("+0130") == 90);
+    CHECK(OffsetTZ::parseOffset("-0130") == -90);
+    CHECK(rejects([] { OffsetTZ::parseOffset("+-130"); }));
+    CHECK(rejects([] { OffsetTZ::parseOffset("++130"); }));
+    CHECK(rejects([] { OffsetTZ::parseOffset("+01-3"); }));
+}
+
+int main()
+{
+    check_numbers();
+    check_fixed_width_fields();
+    return test_result();
+}
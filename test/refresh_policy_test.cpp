@@ -0,0 +1,300 @@
+#include <string.h>
+
+#include "check.h"
+#include "deadline_queue.h"
+#include "refresh_policy.h"
+
+using namespace Project;
+
+// The limits the firmware runs with
+static const RefreshPolicy::Limits LIMITS = {20, 2.0f, 60 * 60 * 1000};
+static const unsigned long HOUR = 60 * 60 * 1000;
+
+// Clock ticks are pushed with this budget in the firmware
+static const unsigned long CLOCK_BUDGET_MS = 800;
+
+static bool due(const RefreshPolicy &policy, unsigned long now, const char *reason)
+{
+    const char *due = policy.cleanDue(now);
+    return reason == nullptr ? due == nullptr : due != nullptr && strcmp(due, reason) == 0;
+}
+
+// pushFrame(), scheduleCleanRefresh(), runDeadlines() and selectMode()
+// from Robotica_Calendar.cpp, cut down to what decides the refresh
+class Device
+{
+public:
+    enum deadline_t
+    {
+        CLEAN_REFRESH,
+        DEADLINES
+    };
+
+    RefreshPolicy policy;
+    DeadlineQueue deadlines;
+    seconds_t now;
+    bool mono;
+    // Something in the framebuffer that isn't on the panel yet
+    bool pending;
+    unsigned refreshes[RefreshPolicy::REFRESH_KINDS];
+
+    Device(seconds_t now) : policy(LIMITS), deadlines(DEADLINES), now(now), mono(true), pending(false), refreshes{} {}
+
+    unsigned long millis() const { return (unsigned long)this->now * 1000; }
+
+    void pushFrame(float dirty, unsigned long budget_ms)
+    {
+        RefreshPolicy::Decision decision = this->policy.decide(this->mono, dirty, budget_ms);
+        if (decision.refresh == RefreshPolicy::NONE)
+        {
+            if (dirty > 0)
+            {
+                this->pending = true;
+                this->scheduleCleanRefresh(0);
+            }
+            return;
+        }
+        this->policy.record(decision.refresh, dirty, decision.estimate_ms, this->millis());
+        this->pending = false;
+        ++this->refreshes[decision.refresh];
+        this->scheduleCleanRefresh(this->policy.cleanIn(this->millis()));
+    }
+
+    void scheduleCleanRefresh(unsigned long in_ms)
+    {
+        this->deadlines.schedule(CLEAN_REFRESH, this->now + (in_ms + 999) / 1000);
+    }
+
+    // The whole page drawn again, in 3-bit mode for a clean refresh
+    void showPage()
+    {
+        bool mono = this->policy.cleanDue(this->millis()) == nullptr;
+        float dirty = mono != this->mono ? 1.0f : 0.01f;
+        this->mono = mono;
+        this->pushFrame(dirty, RefreshPolicy::UNLIMITED);
+    }
+
+    // A pass of loop() at now, then as many more as run something
+    void loop()
+    {
+        unsigned id;
+        while (this->deadlines.pop(this->now, id))
+        {
+            this->showPage();
+        }
+    }
+
+    void clockTick()
+    {
+        this->pushFrame(this->pending ? 0.02f : 0.01f, CLOCK_BUDGET_MS);
+    }
+};
+
+int main()
+{
+    // A full refresh is forced after 20 partial updates
+    {
+        RefreshPolicy policy(LIMITS);
+        policy.record(RefreshPolicy::FULL_GRAY, 1, 1700, 0);
+        for (unsigned i = 0; i < 20; ++i)
+        {
+            RefreshPolicy::Decision decision = policy.decide(true, 0.01f);
+            CHECK(decision.refresh == RefreshPolicy::PARTIAL);
+            CHECK(due(policy, 1000, nullptr));
+            policy.record(decision.refresh, 0.01f, 360, 1000);
+        }
+        CHECK(policy.partials() == 20);
+        CHECK(due(policy, 1000, "partial update limit"));
+        RefreshPolicy::Decision decision = policy.decide(true, 0.01f);
+        CHECK(decision.refresh == RefreshPolicy::FULL_MONO);
+        CHECK(strcmp(decision.reason, "ghosting limit") == 0);
+
+        // which starts the count again
+        policy.record(RefreshPolicy::FULL_MONO, 0.01f, 1100, 1000);
+        CHECK(policy.partials() == 0);
+        CHECK(due(policy, 1000, nullptr));
+        CHECK(policy.decide(true, 0.01f).refresh == RefreshPolicy::PARTIAL);
+    }
+
+    // or once partial updates have covered two screens, however few
+    {
+        RefreshPolicy policy(LIMITS);
+        policy.record(RefreshPolicy::FULL_GRAY, 1, 1700, 0);
+        for (unsigned i = 0; i < 4; ++i)
+        {
+            RefreshPolicy::Decision decision = policy.decide(true, 0.5f);
+            CHECK(decision.refresh == RefreshPolicy::PARTIAL);
+            policy.record(decision.refresh, 0.5f, 450, 1000);
+        }
+        CHECK(policy.partials() == 4);
+        CHECK(policy.partialArea() >= 2.0f);
+        CHECK(due(policy, 1000, "partial area limit"));
+        CHECK(policy.decide(true, 0.01f).refresh == RefreshPolicy::FULL_MONO);
+
+        // An update that would take the area past the limit isn't partial
+        // either, even before the limit is reached
+        RefreshPolicy fresh(LIMITS);
+        fresh.record(RefreshPolicy::FULL_GRAY, 1, 1700, 0);
+        fresh.record(RefreshPolicy::PARTIAL, 0.5f, 450, 1000);
+        fresh.record(RefreshPolicy::PARTIAL, 0.5f, 450, 1000);
+        fresh.record(RefreshPolicy::PARTIAL, 0.5f, 450, 1000);
+        CHECK(due(fresh, 1000, nullptr));
+        CHECK(fresh.decide(true, 0.6f).refresh == RefreshPolicy::FULL_MONO);
+    }
+
+    // A grayscale refresh is due an hour after the last one, whatever
+    // happened in between
+    {
+        RefreshPolicy policy(LIMITS);
+        unsigned long start = 5000;
+        policy.record(RefreshPolicy::FULL_GRAY, 1, 1700, start);
+        CHECK(due(policy, start + HOUR - 1, nullptr));
+        CHECK(due(policy, start + HOUR, "clean refresh interval"));
+
+        // Neither partial updates nor 1-bit full refreshes count
+        policy.record(RefreshPolicy::PARTIAL, 0.01f, 360, start + HOUR / 2);
+        policy.record(RefreshPolicy::FULL_MONO, 1, 1100, start + HOUR / 2);
+        CHECK(due(policy, start + HOUR, "clean refresh interval"));
+
+        policy.record(RefreshPolicy::FULL_GRAY, 1, 1700, start + HOUR);
+        CHECK(due(policy, start + HOUR, nullptr));
+        CHECK(due(policy, start + 2 * HOUR, "clean refresh interval"));
+
+        // millis() wrapping around doesn't make one due early
+        RefreshPolicy wrapped(LIMITS);
+        wrapped.record(RefreshPolicy::FULL_GRAY, 1, 1700, (unsigned long)-1000);
+        CHECK(due(wrapped, HOUR - 1001, nullptr));
+        CHECK(due(wrapped, HOUR - 1000, "clean refresh interval"));
+    }
+
+    // cleanIn() says when to schedule the clean refresh for, so an idle
+    // screen gets it too
+    {
+        RefreshPolicy policy(LIMITS);
+        unsigned long start = 5000;
+        policy.record(RefreshPolicy::FULL_GRAY, 1, 1700, start);
+        CHECK(policy.cleanIn(start) == HOUR);
+        CHECK(policy.cleanIn(start + HOUR / 4) == HOUR * 3 / 4);
+        unsigned long in_ms = policy.cleanIn(start + 1);
+        CHECK(due(policy, start + 1 + in_ms - 1, nullptr));
+        CHECK(due(policy, start + 1 + in_ms, "clean refresh interval"));
+        CHECK(policy.cleanIn(start + HOUR) == 0);
+        CHECK(policy.cleanIn(start + 2 * HOUR) == 0);
+
+        // Reaching a ghosting limit makes it due at once
+        for (unsigned i = 0; i < 19; ++i)
+        {
+            policy.record(RefreshPolicy::PARTIAL, 0.01f, 360, start);
+        }
+        CHECK(policy.cleanIn(start) == HOUR);
+        policy.record(RefreshPolicy::PARTIAL, 0.01f, 360, start);
+        CHECK(policy.cleanIn(start) == 0);
+
+        policy.record(RefreshPolicy::FULL_GRAY, 1, 1700, start + 60000);
+        CHECK(policy.cleanIn(start + 60000) == HOUR);
+    }
+
+    // Updates that don't fit the budget are put off. The firmware then
+    // makes the clean refresh deadline due, see Device below.
+    {
+        RefreshPolicy policy(LIMITS);
+        policy.record(RefreshPolicy::FULL_GRAY, 1, 1700, 0);
+
+        unsigned long partial = policy.estimate(RefreshPolicy::PARTIAL, 0.01f);
+        RefreshPolicy::Decision decision = policy.decide(true, 0.01f, partial - 1);
+        CHECK(decision.refresh == RefreshPolicy::NONE);
+        CHECK(strcmp(decision.reason, "partial update over budget") == 0);
+        CHECK(decision.alternative_ms == partial);
+
+        decision = policy.decide(true, 0.01f, partial);
+        CHECK(decision.refresh == RefreshPolicy::PARTIAL);
+
+        // Nothing is recorded for a deferred update
+        CHECK(policy.partials() == 0);
+
+        // A forced full refresh is deferred the same way
+        for (unsigned i = 0; i < 20; ++i)
+        {
+            policy.record(RefreshPolicy::PARTIAL, 0.01f, 360, 1000);
+        }
+        decision = policy.decide(true, 0.01f, 500);
+        CHECK(decision.refresh == RefreshPolicy::NONE);
+        CHECK(decision.alternative_ms == policy.estimate(RefreshPolicy::FULL_MONO, 0.01f));
+        CHECK(policy.decide(true, 0.01f).refresh == RefreshPolicy::FULL_MONO);
+
+        // and so is a grayscale one
+        decision = policy.decide(false, 0.01f, 500);
+        CHECK(decision.refresh == RefreshPolicy::NONE);
+        CHECK(strcmp(decision.reason, "grayscale refresh over budget") == 0);
+    }
+
+    // A clock tick can't fit the full refresh the 21st partial update
+    // forces, the clean refresh deadline does it instead and the clock
+    // keeps going
+    {
+        Device device(1000);
+        device.pushFrame(1.0f, RefreshPolicy::UNLIMITED);
+        CHECK(device.refreshes[RefreshPolicy::FULL_MONO] == 1);
+
+        bool stuck = false;
+        for (unsigned minute = 1; minute <= 25; ++minute)
+        {
+            device.now += 60;
+            device.clockTick();
+            device.loop();
+            stuck = stuck || device.pending;
+        }
+        CHECK(!stuck);
+        CHECK(device.refreshes[RefreshPolicy::PARTIAL] >= 21);
+        CHECK(device.refreshes[RefreshPolicy::FULL_MONO] + device.refreshes[RefreshPolicy::FULL_GRAY] >= 2);
+        CHECK(device.policy.partials() < 20);
+
+        // Nor does the area limit stop it, with ticks that change more
+        for (unsigned minute = 0; minute < 10; ++minute)
+        {
+            device.now += 60;
+            device.pushFrame(0.3f, CLOCK_BUDGET_MS);
+            device.loop();
+            stuck = stuck || device.pending;
+        }
+        CHECK(!stuck);
+        CHECK(device.policy.partialArea() <= 2.0f);
+    }
+
+    // Left alone for a day, the screen gets its hourly grayscale refresh
+    // and every clock tick reaches the panel
+    {
+        Device device(1000);
+        device.pushFrame(1.0f, RefreshPolicy::UNLIMITED);
+        bool stuck = false;
+        for (unsigned minute = 1; minute <= 24 * 60; ++minute)
+        {
+            device.now += 60;
+            device.clockTick();
+            device.loop();
+            stuck = stuck || device.pending;
+        }
+        CHECK(!stuck);
+        CHECK(device.refreshes[RefreshPolicy::FULL_GRAY] >= 24);
+        CHECK(device.policy.cleanDue(device.millis()) == nullptr);
+    }
+
+    // Full refreshes that are over budget leave the partial update
+    // as the only choice, even when it would otherwise lose
+    {
+        RefreshPolicy policy(LIMITS);
+        policy.record(RefreshPolicy::FULL_GRAY, 1, 1700, 0);
+        CHECK(policy.decide(true, 1.0f).refresh == RefreshPolicy::FULL_MONO);
+        RefreshPolicy::Decision decision = policy.decide(true, 1.0f, 1000);
+        CHECK(decision.refresh == RefreshPolicy::PARTIAL);
+        CHECK(strcmp(decision.reason, "full refresh over budget") == 0);
+    }
+
+    // Nothing changed, nothing to do
+    {
+        RefreshPolicy policy(LIMITS);
+        CHECK(policy.decide(true, 0).refresh == RefreshPolicy::NONE);
+    }
+
+    return test_result();
+}
@@ -0,0 +1,245 @@
+#include <random>
+#include <string>
+#include <vector>
+
+#include "check.h"
+#include "text_layout.h"
+
+using namespace Project;
+
+// Printable ASCII with random metrics, for comparing with the loop
+// wrap_text() replaced
+static GFXglyph ascii_glyphs[0x7f - 0x20];
+static GFXfont ascii_font = {nullptr, ascii_glyphs, 0x20, 0x7e, 29};
+
+// Every glyph up to U+00FF 8 wide with an advance of 10, space blank
+static GFXglyph latin1_glyphs[0x100 - 0x20];
+static GFXfont latin1_font = {nullptr, latin1_glyphs, 0x20, 0xff, 29};
+
+static void make_fonts()
+{
+    std::mt19937 rng(3);
+    for (GFXglyph &glyph : ascii_glyphs)
+    {
+        glyph.width = 4 + rng() % 12;
+        glyph.xOffset = (int)(rng() % 3) - 1;
+        glyph.xAdvance = glyph.width + 1 + rng() % 3;
+    }
+    ascii_glyphs[0] = GFXglyph{0, 0, 0, 6, 0, 0};
+
+    for (GFXglyph &glyph : latin1_glyphs)
+    {
+        glyph = GFXglyph{0, 8, 10, 10, 0, -10};
+    }
+    latin1_glyphs[0].width = 0;
+}
+
+// Adafruit_GFX::getTextBounds() width for ASCII in the random font
+static int bounds(const std::string &text)
+{
+    int x = 0, min_x = INT16_MAX, max_x = -1;
+    for (unsigned char ch : text)
+    {
+        const GFXglyph &glyph = ascii_glyphs[ch - 0x20];
+        min_x = std::min(min_x, x + glyph.xOffset);
+        max_x = std::max(max_x, x + glyph.xOffset + glyph.width - 1);
+        x += glyph.xAdvance;
+    }
+    return max_x >= min_x ? max_x - min_x + 1 : 0;
+}
+
+// The character by character loop drawEvent() used to wrap titles with
+static std::vector<std::string> original_wrap(const std::string &text, int max_width)
+{
+    std::vector<std::string> lines;
+    std::string line;
+    int last_space = -100;
+    for (int i = 0; i < (int)text.size(); ++i)
+    {
+        line += text[i];
+        int n = line.size();
+        if (text[i] == ' ')
+        {
+            last_space = n - 1;
+        }
+        if (bounds(line) > max_width && n > 1)
+        {
+            if (n - last_space - 1 < 15)
+            {
+                i -= n - last_space - 1;
+                line.resize(last_space);
+            }
+            else
+            {
+                i -= 1;
+                line.resize(n - 1);
+            }
+            lines.push_back(line);
+            line.clear();
+            last_space = -100;
+        }
+    }
+    lines.push_back(line);
+    return lines;
+}
+
+static void check_matches_original()
+{
+    const FontMetrics &metrics = FontMetrics::get(&ascii_font);
+    std::mt19937 rng(4);
+    std::vector<TextLine> lines;
+    for (int title = 0; title < 20000; ++title)
+    {
+        std::string text;
+        int length = rng() % 120;
+        for (int i = 0; i < length; ++i)
+        {
+            text += rng() % 8 == 0 ? ' ' : (char)('a' + rng() % 26);
+        }
+        int max_width = 80 + rng() % 120;
+
+        wrap_text(metrics, string_ref(text.data(), text.size()), max_width, lines);
+        std::vector<std::string> expected = original_wrap(text, max_width);
+
+        bool same = lines.size() == expected.size();
+        for (size_t i = 0; same && i < lines.size(); ++i)
+        {
+            std::string line = text.substr(lines[i].offset, lines[i].length);
+            same = line == expected[i] && bounds(line) == lines[i].width;
+        }
+        CHECK(same);
+    }
+}
+
+static void check_decoding()
+{
+    struct decode_case
+    {
+        const char *text;
+        uint32_t codepoint;
+        size_t length;
+    };
+    const decode_case cases[] = {
+        {"A", 'A', 1},
+        {"\xc3\xa9", 0xe9, 2},             // é
+        {"\xe2\x82\xac", 0x20ac, 3},       // €
+        {"\xf0\x9f\x98\x80", 0x1f600, 4},  // emoji
+        {"\x80", 0xfffd, 1},               // stray continuation byte
+        {"\xff", 0xfffd, 1},               // never valid
+        {"\xe2\x82", 0xfffd, 1},           // cut short
+        {"\xc3" "A", 0xfffd, 1},           // not followed by a continuation
+    };
+    for (const decode_case &test : cases)
+    {
+        size_t pos = 0;
+        CHECK(next_codepoint(string_ref(test.text), pos) == test.codepoint);
+        CHECK(pos == test.length);
+    }
+}
+
+static std::vector<std::string> wrap(const std::string &text, int max_width, std::vector<TextLine> &lines)
+{
+    wrap_text(FontMetrics::get(&latin1_font), string_ref(text.data(), text.size()), max_width, lines);
+    std::vector<std::string> result;
+    for (const TextLine &line : lines)
+    {
+        result.push_back(text.substr(line.offset, line.length));
+    }
+    return result;
+}
+
+static void check_boundaries()
+{
+    using lines_t = std::vector<std::string>;
+    std::vector<TextLine> lines;
+
+    // Always a line, even for nothing
+    CHECK(wrap("", 100, lines) == lines_t{""});
+    CHECK(lines[0].width == 0);
+
+    // Four glyphs are 38 wide: an exact fit stays on one line
+    CHECK(wrap("abcd", 38, lines) == lines_t{"abcd"});
+    CHECK(lines[0].width == 38);
+    CHECK((wrap("abcd", 37, lines) == lines_t{"abc", "d"}));
+    CHECK(lines[0].width == 28 && lines[1].width == 8);
+
+    // Break at the last space, which goes
+    CHECK((wrap("hello world", 60, lines) == lines_t{"hello", "world"}));
+    CHECK(lines[0].width == 48);
+
+    // 15 or more characters after the space break mid word instead,
+    // fewer are carried over
+    std::string long_word = "a " + std::string(30, 'b');
+    CHECK((wrap(long_word, 198, lines) == lines_t{"a " + std::string(18, 'b'), std::string(12, 'b')}));
+    CHECK((wrap("a " + std::string(14, 'b'), 148, lines) == lines_t{"a", std::string(14, 'b')}));
+
+    // A glyph wider than the line still goes somewhere
+    CHECK((wrap("ab", 5, lines) == lines_t{"a", "b"}));
+
+    // Two byte characters are never split
+    CHECK((wrap("\xc3\xa9\xc3\xa9\xc3\xa9\xc3\xa9\xc3\xa9\xc3\xa9", 35, lines) ==
+           lines_t{"\xc3\xa9\xc3\xa9\xc3\xa9", "\xc3\xa9\xc3\xa9\xc3\xa9"}));
+    CHECK(lines[0].width == 28);
+
+    // Characters the font doesn't have take no room, and stay whole
+    CHECK((wrap("ab\xe2\x82\xac" "cd", 38, lines) == lines_t{"ab\xe2\x82\xac" "cd"}));
+    CHECK((wrap("abc\xe2\x82\xac" "d", 28, lines) == lines_t{"abc\xe2\x82\xac", "d"}));
+}
+
+// Random titles mixing ASCII, two and three byte characters: lines
+// start on whole characters, cover the title less the spaces broken at,
+// fit unless they are a single character, and have the width measured
+static void check_utf8_titles()
+{
+    const FontMetrics &metrics = FontMetrics::get(&latin1_font);
+    const char *pieces[] = {"a", "b", "z", " ", "\xc3\xa9", "\xc3\xbc", "\xe2\x82\xac", "\xc3"};
+    std::mt19937 rng(5);
+    std::vector<TextLine> lines;
+    for (int title = 0; title < 5000; ++title)
+    {
+        std::string text;
+        int count = rng() % 80;
+        for (int i = 0; i < count; ++i)
+        {
+            text += pieces[rng() % 8];
+        }
+        int max_width = 20 + rng() % 200;
+        string_ref ref(text.data(), text.size());
+        wrap_text(metrics, ref, max_width, lines);
+
+        CHECK(!lines.empty());
+        size_t expected_start = 0;
+        for (const TextLine &line : lines)
+        {
+            if (line.offset == expected_start + 1 && text[expected_start] == ' ')
+            {
+                ++expected_start;
+            }
+            CHECK(line.offset == expected_start);
+            CHECK(((uint8_t)text[line.offset] & 0xc0) != 0x80 || line.length == 0);
+            expected_start = line.offset + line.length;
+
+            TextExtent extent;
+            size_t pos = line.offset, characters = 0;
+            while (pos < (size_t)line.offset + line.length)
+            {
+                extent.add(metrics.glyph(next_codepoint(ref, pos)));
+                ++characters;
+            }
+            CHECK(pos == (size_t)line.offset + line.length);
+            CHECK(extent.width() == line.width);
+            CHECK(line.width <= max_width || characters == 1);
+        }
+        CHECK(expected_start == text.size());
+    }
+}
+
+int main()
+{
+    make_fonts();
+    check_matches_original();
+    check_decoding();
+    check_boundaries();
+    check_utf8_titles();
+    return test_result();
+}
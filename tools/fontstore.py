@@ -0,0 +1,103 @@
+#!/usr/bin/env python3
+"""Build a font partition image from Adafruit GFX font headers.
+
+    tools/fontstore.py -o fonts.bin FreeSans12pt7b.h FreeSans9pt7b.h ...
+
+Each font is stored under its GFXfont name, e.g. "FreeSans12pt7b". See
+src/font_store.h for the layout. Flash the image to the "fonts"
+partition from partitions.csv, e.g.
+
+    esptool.py write_flash 0x380000 fonts.bin
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+MAGIC = 0x53464352  # "RCFS"
+VERSION = 1
+NAME_LENGTH = 24
+
+HEADER = struct.Struct("<IHH")
+FONT = struct.Struct("<%dsIIIIIB3x" % NAME_LENGTH)
+GLYPH = struct.Struct("<IBbBBb3x")
+
+
+def parse_header(text):
+    """Yield (name, first, y_advance, glyphs, bitmap) for each GFXfont."""
+    text = re.sub(r"//.*", "", text)
+    text = re.sub(r"/\*.*?\*/", "", text, flags=re.S)
+
+    arrays = {}
+    for match in re.finditer(r"(\w+)\s*\[\s*\]\s*(?:PROGMEM\s*)?=\s*\{(.*?)\};", text, re.S):
+        arrays[match.group(1)] = match.group(2)
+
+    for match in re.finditer(r"const\s+GFXfont\s+(\w+)\s*(?:PROGMEM\s*)?=\s*\{(.*?)\};", text, re.S):
+        name = match.group(1)
+        fields = [f.strip() for f in match.group(2).split(",") if f.strip()]
+        bitmap_name = re.search(r"(\w+)\s*$", fields[0]).group(1)
+        glyph_name = re.search(r"(\w+)\s*$", fields[1]).group(1)
+        first = int(fields[2], 0)
+        y_advance = int(fields[4], 0)
+
+        bitmap = bytes(int(b, 0) for b in arrays[bitmap_name].replace("\n", " ").split(",") if b.strip())
+        glyphs = [tuple(int(v, 0) for v in g.split(","))
+                  for g in re.findall(r"\{([^{}]*)\}", arrays[glyph_name])]
+        yield name, first, y_advance, glyphs, bitmap
+
+
+def align(data, boundary=4):
+    return data + b"\0" * (-len(data) % boundary)
+
+
+def build(fonts):
+    directory_end = HEADER.size + FONT.size * len(fonts)
+    body = bytearray()
+    entries = []
+    for name, first, y_advance, glyphs, bitmap in fonts:
+        if len(name.encode()) >= NAME_LENGTH:
+            sys.exit("font name too long: %s" % name)
+
+        # GFX fonts cover first to last without gaps
+        codepoints = b"".join(struct.pack("<I", first + i) for i in range(len(glyphs)))
+        records = b"".join(GLYPH.pack(offset, x_advance, x_offset, width, height, y_offset)
+                           for offset, width, height, x_advance, x_offset, y_offset in glyphs)
+
+        body = bytearray(align(bytes(body)))
+        codepoints_offset = directory_end + len(body)
+        body += codepoints
+        glyphs_offset = directory_end + len(body)
+        body += records
+        bitmap_offset = directory_end + len(body)
+        body += bitmap
+
+        entries.append(FONT.pack(name.encode(), len(glyphs), codepoints_offset, glyphs_offset,
+                                 bitmap_offset, len(bitmap), y_advance))
+
+    return HEADER.pack(MAGIC, VERSION, len(fonts)) + b"".join(entries) + bytes(body)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("-o", "--output", required=True, help="image to write")
+    parser.add_argument("headers", nargs="+", help="Adafruit GFX font headers")
+    args = parser.parse_args()
+
+    fonts = []
+    for path in args.headers:
+        with open(path) as f:
+            fonts.extend(parse_header(f.read()))
+    if not fonts:
+        sys.exit("no GFXfont found")
+
+    image = build(fonts)
+    with open(args.output, "wb") as f:
+        f.write(image)
+    for name, first, _, glyphs, bitmap in fonts:
+        print("%-24s U+%04X-U+%04X %6d bitmap bytes" % (name, first, first + len(glyphs) - 1, len(bitmap)))
+    print("%d bytes" % len(image))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,281 @@
+// Host side renderer for thin client mode: draws the calendar for each
+// of a number of panels, one thread per panel, and writes a key frame
+// followed by a delta per minute for each, as they would be published to
+// the panels.
+//
+//     render_panels [-n panels] [-m minutes] [-r rotation] [-o dir] fonts.bin [title_font small_font]
+//
+// Pages are drawn by CalendarPage, as on the device, in the layout of
+// config.h.src. Fonts come from a font partition image, see
+// tools/fontstore.py, and are the ones the device uses unless others are
+// named. The events are made up, the same every run, and the clock
+// starts at 09:00 UTC on the first day shown.
+
+#include <chrono>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "band_render.h"
+#include "calendar_page.h"
+#include "display_list.h"
+#include "font_store.h"
+#include "frame_delta.h"
+#include "frame_diff.h"
+#include "glyph_atlas.h"
+#include "layout_cache.h"
+#include "tz.h"
+
+using namespace Project;
+
+namespace
+{
+    // Inkplate 6PLUS
+    const int PANEL_WIDTH = 1024;
+    const int PANEL_HEIGHT = 758;
+
+    // Number of wrapped titles each panel remembers, as on the device
+    const size_t LAYOUT_CACHE_SIZE = 256;
+
+    const char *const WORDS[] = {"team", "meeting", "dentist", "school", "pickup", "swimming", "lessons",
+                                 "review", "lunch", "with", "grandma", "planning", "football", "practice",
+                                 "bins", "out", "piano", "call", "about", "the", "roadmap", "library"};
+
+    struct options
+    {
+        unsigned panels = 24;
+        unsigned minutes = 10;
+        int rotation = 0;
+        std::string dir = ".";
+        const FontMetrics *title_font = nullptr;
+        const FontMetrics *small_font = nullptr;
+    };
+
+    struct panel_result
+    {
+        size_t key_bytes = 0;
+        size_t delta_bytes = 0;
+        bool ok = true;
+    };
+
+    // Made up events for a panel over the days from begin_date, the same
+    // every run. Some start on the first morning while the clock runs,
+    // and some days have more than fit.
+    std::vector<entry> make_events(unsigned panel, const Date &begin_date, int days)
+    {
+        std::vector<entry> events;
+        for (int day = 0; day < days; ++day)
+        {
+            std::mt19937 rng(panel * 31 + day);
+            seconds_t start = (begin_date + day).start_of_day(tz_UTC).epoch_time.epochSeconds + 8 * 3600;
+            int count = 2 + rng() % 9;
+            for (int i = 0; i < count; ++i)
+            {
+                std::string title;
+                int words = 1 + rng() % 6;
+                for (int w = 0; w < words; ++w)
+                {
+                    title += (w == 0 ? "" : " ");
+                    title += WORDS[rng() % (sizeof(WORDS) / sizeof(WORDS[0]))];
+                }
+
+                start += (1 + rng() % 4) * 15 * 60;
+                DateTime start_time(start, tz_UTC);
+                DateTime end_time(start + (1 + rng() % 8) * 15 * 60, tz_UTC);
+                status_t status = rng() % 10 == 0 ? cancelled : pending;
+                int importance = rng() % 4;
+                events.push_back(entry(title, start_time, end_time, start_time.date(), end_time.date(), 0, status, importance));
+            }
+        }
+        return events;
+    }
+
+    bool write_file(const std::string &path, const std::vector<uint8_t> &data)
+    {
+        FILE *file = fopen(path.c_str(), "wb");
+        if (file == nullptr)
+        {
+            return false;
+        }
+        bool ok = fwrite(data.data(), 1, data.size(), file) == data.size();
+        return fclose(file) == 0 && ok;
+    }
+
+    // Everything one panel needs is its own, apart from the fonts and
+    // glyph atlases, which are only read. The page is drawn in full each
+    // minute, the tile diff finds what changed.
+    void render_panel(const options &opts, unsigned panel, panel_result &result)
+    {
+        std::vector<uint8_t> frames[2];
+        frames[0].resize(PANEL_WIDTH / 8 * PANEL_HEIGHT);
+        frames[1].resize(PANEL_WIDTH / 8 * PANEL_HEIGHT);
+
+        // The layout of config.h.src, on the panel as rotated
+        page_style style;
+        style.width = opts.rotation & 1 ? PANEL_HEIGHT : PANEL_WIDTH;
+        style.height = opts.rotation & 1 ? PANEL_WIDTH : PANEL_HEIGHT;
+        style.column_width = (style.width - 2 * style.border_width) / style.columns;
+        style.title_font = opts.title_font;
+        style.small_font = opts.small_font;
+
+        LayoutCache cache(LAYOUT_CACHE_SIZE);
+        CalendarPage calendar(style, cache, tz_UTC);
+        Date begin_date(2024, 3, 4);
+        calendar.setEvents(make_events(panel, begin_date, style.columns));
+        seconds_t start = begin_date.start_of_day(tz_UTC).epoch_time.epochSeconds + 9 * 3600;
+
+        DisplayList list;
+        page_layout layout;
+        TileDiff diff(PANEL_WIDTH, PANEL_HEIGHT, 1);
+        std::vector<uint8_t> message;
+        auto sink = [&message](const uint8_t *data, size_t len)
+        {
+            message.insert(message.end(), data, data + len);
+            return true;
+        };
+
+        for (unsigned minute = 0; minute <= opts.minutes; ++minute)
+        {
+            const uint8_t *base = minute == 0 ? nullptr : frames[(minute - 1) % 2].data();
+            std::vector<uint8_t> &frame = frames[minute % 2];
+            seconds_t now = start + minute * 60;
+
+            list.clear();
+            list.fillRect(0, 0, style.width, style.height, 7);
+            calendar.drawInfo(list);
+            calendar.drawGrid(list, begin_date);
+            calendar.drawData(list, begin_date, now, layout);
+            calendar.drawTime(list, now);
+
+            Raster target(frame.data(), PANEL_WIDTH, PANEL_HEIGHT, opts.rotation, Raster::MONO);
+            render_bands(list, target, 1);
+
+            diff.update(frame.data());
+            delta_info info = {1, (uint8_t)opts.rotation, PANEL_WIDTH, PANEL_HEIGHT, 0, 0, 0};
+            message.clear();
+            if (encode_frame_delta(info, base, frame.data(), diff.regions(), sink) == 0)
+            {
+                result.ok = false;
+                return;
+            }
+            diff.commit();
+
+            (base == nullptr ? result.key_bytes : result.delta_bytes) += message.size();
+
+            char name[32];
+            snprintf(name, sizeof(name), "/panel%02u-%03u.delta", panel, minute);
+            if (!write_file(opts.dir + name, message))
+            {
+                result.ok = false;
+                return;
+            }
+        }
+    }
+
+    void usage()
+    {
+        fprintf(stderr, "usage: render_panels [-n panels] [-m minutes] [-r rotation] [-o dir] fonts.bin [title_font small_font]\n");
+        exit(2);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    options opts;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:m:r:o:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'n':
+            opts.panels = atoi(optarg);
+            break;
+        case 'm':
+            opts.minutes = atoi(optarg);
+            break;
+        case 'r':
+            opts.rotation = atoi(optarg) & 3;
+            break;
+        case 'o':
+            opts.dir = optarg;
+            break;
+        default:
+            usage();
+        }
+    }
+    if ((argc - optind != 1 && argc - optind != 3) || opts.panels == 0)
+    {
+        usage();
+    }
+
+    // Read, not mapped, the store only needs the data to stay put
+    std::vector<uint8_t> image;
+    FILE *file = fopen(argv[optind], "rb");
+    if (file == nullptr)
+    {
+        perror(argv[optind]);
+        return 1;
+    }
+    uint8_t buffer[4096];
+    size_t len;
+    while ((len = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        image.insert(image.end(), buffer, buffer + len);
+    }
+    fclose(file);
+
+    FontStore store(image.data(), image.size());
+    const char *names[2] = {"FreeSans12pt7b", "FreeSans9pt7b"};
+    if (argc - optind == 3)
+    {
+        names[0] = argv[optind + 1];
+        names[1] = argv[optind + 2];
+    }
+    opts.title_font = store.find(names[0]);
+    opts.small_font = store.find(names[1]);
+    if (opts.title_font == nullptr || opts.small_font == nullptr)
+    {
+        fprintf(stderr, "%s: no font %s\n", argv[optind], opts.title_font == nullptr ? names[0] : names[1]);
+        return 1;
+    }
+
+    // Atlases are not thread safe to fill, so every glyph goes in now
+    // and the panel threads only read them
+    GlyphAtlas::get(*opts.title_font, opts.rotation, Raster::MONO).addAll();
+    GlyphAtlas::get(*opts.small_font, opts.rotation, Raster::MONO).addAll();
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<panel_result> results(opts.panels);
+    std::vector<std::thread> threads;
+    for (unsigned panel = 0; panel < opts.panels; ++panel)
+    {
+        threads.emplace_back(render_panel, std::cref(opts), panel, std::ref(results[panel]));
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+    size_t key_bytes = 0, delta_bytes = 0;
+    bool ok = true;
+    for (const panel_result &result : results)
+    {
+        key_bytes += result.key_bytes;
+        delta_bytes += result.delta_bytes;
+        ok = ok && result.ok;
+    }
+    printf("%u panels, %u frames each in %lld ms; key frames %zu bytes, deltas %zu bytes on average\n",
+           opts.panels, opts.minutes + 1, (long long)ms, key_bytes / opts.panels,
+           opts.minutes == 0 ? 0 : delta_bytes / opts.panels / opts.minutes);
+    if (!ok)
+    {
+        fprintf(stderr, "failed to encode or write some frames\n");
+        return 1;
+    }
+    return 0;
+}